@@ -0,0 +1,49 @@
+#include <zephyr/kernel.h>
+#include <zephyr/sys/printk.h>
+
+#include "bench.h"
+#include "diag.h"
+
+static void bench_report(struct k_work *work);
+static K_WORK_DELAYABLE_DEFINE(report_work, bench_report);
+
+static const enum diag_counter reported[] = {
+    DIAG_SCANS, DIAG_MIDI_EVENTS, DIAG_MIDI_BYTES, DIAG_NOTIFY_SENT, DIAG_SCAN_CPU_US,
+};
+
+static uint32_t last[ARRAY_SIZE(reported)];
+
+// a / b with two decimals, as printk has no floats
+static void print_ratio(const char *name, uint32_t a, uint32_t b) {
+    uint32_t centi = b ? (uint64_t)a * 100 / b : 0;
+
+    printk(" %s=%u.%02u", name, centi / 100, centi % 100);
+}
+
+// One line per interval, counters are deltas since the previous line
+static void bench_report(struct k_work *work) {
+    uint32_t delta[ARRAY_SIZE(reported)];
+
+    for (int i = 0; i < ARRAY_SIZE(reported); i++) {
+        uint32_t now = atomic_get(&diag_counters[reported[i]]);
+        delta[i] = now - last[i];
+        last[i] = now;
+    }
+
+    uint32_t scans = delta[0], events = delta[1], bytes = delta[2], notifies = delta[3],
+             cpu_us = delta[4];
+
+    printk("bench: t=%u scans=%u events=%u bytes=%u notifies=%u", k_uptime_get_32(), scans,
+           events, bytes, notifies);
+    print_ratio("events/scan", events, scans);
+    print_ratio("bytes/event", bytes, events);
+    print_ratio("cpu_us/scan", cpu_us, scans);
+    printk("\n");
+
+    k_work_schedule(&report_work, K_MSEC(CONFIG_APP_BENCH_REPORT_INTERVAL_MS));
+}
+
+void bench_start(void) {
+    printk("bench: ATT MTU %u\n", CONFIG_APP_BENCH_ATT_MTU);
+    k_work_schedule(&report_work, K_MSEC(CONFIG_APP_BENCH_REPORT_INTERVAL_MS));
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <stdint.h>
+#include <zephyr/kernel.h>
+
+/*
+ * CPU time stamps for measuring a section of code, in microseconds.
+ * On native builds this is the host process CPU time, as simulated time
+ * does not advance while code runs.
+ */
+#ifdef CONFIG_NATIVE_BUILD
+
+uint64_t bench_host_cpu_time_ns(void);
+
+static inline uint32_t cpu_stamp(void) {
+    return (uint32_t)(bench_host_cpu_time_ns() / NSEC_PER_USEC);
+}
+
+static inline uint32_t cpu_elapsed_us(uint32_t stamp) {
+    return cpu_stamp() - stamp;
+}
+
+#else
+
+static inline uint32_t cpu_stamp(void) {
+    return k_cycle_get_32();
+}
+
+static inline uint32_t cpu_elapsed_us(uint32_t stamp) {
+    return k_cyc_to_us_floor32(k_cycle_get_32() - stamp);
+}
+
+#endif
+
+#ifdef CONFIG_APP_BENCH
+
+/* Start the periodic report */
+void bench_start(void);
+
+#else
+
+static inline void bench_start(void) {}
+
+#endif
@@ -0,0 +1,11 @@
+/* Runs in the native simulator runner, next to the host C library */
+
+#include <stdint.h>
+#include <time.h>
+
+uint64_t bench_host_cpu_time_ns(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000U + ts.tv_nsec;
+}
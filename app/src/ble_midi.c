@@ -3,6 +3,7 @@
 #include <errno.h>
 #include <stdio.h>
 #include <string.h>
+#include <zephyr/bluetooth/att.h>
 #include <zephyr/bluetooth/bluetooth.h>
 #include <zephyr/bluetooth/conn.h>
 #include <zephyr/bluetooth/gatt.h>
@@ -13,30 +14,89 @@
 #include <zephyr/sys/byteorder.h>
 #include <zephyr/sys/printk.h>
 
+#include "diag.h"
+
 LOG_MODULE_REGISTER(ble_midi, CONFIG_APP_LOG_LEVEL);
 
-static void (*ble_midi_started_cb)(void);
-static bool ble_midi_started = false;
+static ble_midi_started_cb_t ble_midi_started_cb;
 
 static struct pots_params params;
 static bool params_changed = false;
 
+struct midi_pending {
+    bt_gatt_complete_func_t func;
+    void *user_data;
+};
+
+// One per central. Notifications complete in order on a connection, so the
+// in-flight ones are kept as a FIFO of the callers' completion callbacks.
+struct midi_link {
+    struct bt_conn *conn;
+    bool started;
+    bool needs_sync;
+    uint8_t head;
+    uint8_t in_flight;
+    struct midi_pending pending[CONFIG_APP_MIDI_LINK_MAX_IN_FLIGHT];
+};
+
+static struct midi_link links[CONFIG_BT_MAX_CONN];
+static struct k_spinlock links_lock;
+
+#ifdef CONFIG_BT_BUF_ACL_TX_COUNT
+// battery, diagnostics and ATT responses need buffers of their own
+BUILD_ASSERT(CONFIG_BT_BUF_ACL_TX_COUNT > CONFIG_BT_MAX_CONN * CONFIG_APP_MIDI_LINK_MAX_IN_FLIGHT,
+             "MIDI notifications in flight would take every ACL TX buffer");
+#endif
+
+#ifdef CONFIG_APP_BENCH
+// the bench stands in for link 0
+static bool bench_started;
+static bool bench_needs_sync;
+#endif
+
+static struct midi_link *link_find(struct bt_conn *conn) {
+    for (int i = 0; i < ARRAY_SIZE(links); i++) {
+        if (links[i].conn == conn) return &links[i];
+    }
+    return NULL;
+}
+
+static bool link_subscribed(const struct midi_link *link);
+
 static void htmc_ccc_cfg_changed(const struct bt_gatt_attr *attr,
                                  uint16_t value) {
     uint8_t notification_enabled = (value == BT_GATT_CCC_NOTIFY) ? 1 : 0;
     LOG_DBG("MIDI Notifications %s",
             notification_enabled ? "enabled" : "disabled");
 
-    if (!notification_enabled) {
-        ble_midi_started = false;
+    // value is the aggregate of all centrals, check each one
+    k_spinlock_key_t key = k_spin_lock(&links_lock);
+    for (int i = 0; i < ARRAY_SIZE(links); i++) {
+        if (links[i].started && !link_subscribed(&links[i])) {
+            links[i].started = false;
+        }
     }
+    k_spin_unlock(&links_lock, key);
 }
 
 ssize_t midi_read_char(struct bt_conn *conn, const struct bt_gatt_attr *attr,
                        void *buf, uint16_t len, uint16_t offset) {
-    if (!ble_midi_started) {
-        ble_midi_started = true;
-        if (ble_midi_started_cb) ble_midi_started_cb();
+    bool first = !ble_midi_is_started();
+    bool started = false;
+
+    k_spinlock_key_t key = k_spin_lock(&links_lock);
+    struct midi_link *link = link_find(conn);
+    if (!link) link = link_find(NULL);
+    if (link && !link->started) {
+        if (!link->conn) link->conn = bt_conn_ref(conn);
+        link->started = true;
+        link->needs_sync = true;
+        started = true;
+    }
+    k_spin_unlock(&links_lock, key);
+
+    if (started) {
+        if (ble_midi_started_cb) ble_midi_started_cb(first);
         LOG_DBG("MIDI started");
     }
 
@@ -51,6 +111,12 @@ static ssize_t midi_write_char(struct bt_conn *conn, const struct bt_gatt_attr *
         params.fast_refresh_period_ms = sys_get_le16((uint8_t *)buf + 4);
         params.fast_refresh_retention_ms = sys_get_le16((uint8_t *)buf + 6);
 
+        // goals are optional, older hosts only write the periods
+        if (len >= 11) {
+            params.latency_goal_ms = sys_get_le16((uint8_t *)buf + 8);
+            params.power_goal = ((uint8_t *)buf)[10];
+        }
+
         params_changed = true;
     }
     return len;
@@ -62,12 +128,70 @@ BT_GATT_SERVICE_DEFINE(midi_ble_svc,
                                               BT_GATT_PERM_READ | BT_GATT_PERM_WRITE, midi_read_char, midi_write_char, NULL),
                        BT_GATT_CCC(htmc_ccc_cfg_changed, BT_GATT_PERM_READ | BT_GATT_PERM_WRITE), );
 
-void ble_midi_init(void (*ble_midi_started_cb_)(void)) {
+static bool link_subscribed(const struct midi_link *link) {
+    return bt_gatt_is_subscribed(link->conn, &midi_ble_svc.attrs[1], BT_GATT_CCC_NOTIFY);
+}
+
+static void disconnected(struct bt_conn *conn, uint8_t reason) {
+    struct midi_pending pending[CONFIG_APP_MIDI_LINK_MAX_IN_FLIGHT];
+    int count = 0;
+
+    k_spinlock_key_t key = k_spin_lock(&links_lock);
+    struct midi_link *link = link_find(conn);
+    if (link) {
+        for (int i = 0; i < link->in_flight; i++) {
+            pending[count++] = link->pending[(link->head + i) % CONFIG_APP_MIDI_LINK_MAX_IN_FLIGHT];
+        }
+        bt_conn_unref(link->conn);
+        memset(link, 0, sizeof(*link));
+    }
+    k_spin_unlock(&links_lock, key);
+
+    // release what the callers track for notifications that will never complete
+    for (int i = 0; i < count; i++) {
+        if (pending[i].func) pending[i].func(conn, pending[i].user_data);
+    }
+}
+
+BT_CONN_CB_DEFINE(ble_midi_conn_callbacks) = {
+    .disconnected = disconnected,
+};
+
+void ble_midi_init(ble_midi_started_cb_t ble_midi_started_cb_) {
     ble_midi_started_cb = ble_midi_started_cb_;
 }
 
 bool ble_midi_is_started(void) {
-    return ble_midi_started;
+#ifdef CONFIG_APP_BENCH
+    if (bench_started) return true;
+#endif
+    for (int i = 0; i < ARRAY_SIZE(links); i++) {
+        if (links[i].started) return true;
+    }
+    return false;
+}
+
+int ble_midi_take_sync(void) {
+    int found = -ENOENT;
+
+#ifdef CONFIG_APP_BENCH
+    if (bench_started && bench_needs_sync) {
+        bench_needs_sync = false;
+        return 0;
+    }
+#endif
+
+    k_spinlock_key_t key = k_spin_lock(&links_lock);
+    for (int i = 0; i < ARRAY_SIZE(links); i++) {
+        if (links[i].started && links[i].needs_sync) {
+            links[i].needs_sync = false;
+            found = i;
+            break;
+        }
+    }
+    k_spin_unlock(&links_lock, key);
+
+    return found;
 }
 
 bool ble_midi_params_changed(void) {
@@ -81,10 +205,95 @@ void ble_midi_get_params(struct pots_params *out_params) {
     params_changed = false;
 }
 
-int ble_midi_send_packet(const uint8_t *data, size_t len) {
-    if (!ble_midi_started) {
-        return -EACCES;
+#ifdef CONFIG_APP_BENCH
+void ble_midi_bench_start(void) {
+    bench_started = true;
+    bench_needs_sync = true;
+    if (ble_midi_started_cb) ble_midi_started_cb(true);
+}
+#endif
+
+bool ble_midi_link_ready(int idx) {
+#ifdef CONFIG_APP_BENCH
+    if (bench_started) return idx == 0;
+#endif
+    return links[idx].started && link_subscribed(&links[idx]);
+}
+
+size_t ble_midi_link_max_payload(int idx) {
+#ifdef CONFIG_APP_BENCH
+    return CONFIG_APP_BENCH_ATT_MTU - 3;
+#endif
+    struct bt_conn *conn = links[idx].conn;
+
+    // the default of 23 until the connection negotiated more
+    return (conn ? bt_gatt_get_mtu(conn) : BT_ATT_DEFAULT_LE_MTU) - 3;
+}
+
+static void link_notify_sent(struct bt_conn *conn, void *user_data) {
+    struct midi_link *link = user_data;
+    struct midi_pending pending = {0};
+
+    k_spinlock_key_t key = k_spin_lock(&links_lock);
+    if (link->conn == conn && link->in_flight) {
+        pending = link->pending[link->head];
+        link->head = (link->head + 1) % CONFIG_APP_MIDI_LINK_MAX_IN_FLIGHT;
+        link->in_flight--;
     }
+    k_spin_unlock(&links_lock, key);
 
-    return bt_gatt_notify(NULL, &midi_ble_svc.attrs[1], data, len);
-}
\ No newline at end of file
+    if (pending.func) pending.func(conn, pending.user_data);
+}
+
+// A central that does not keep up only delays its own updates
+static int link_notify(struct midi_link *link, const uint8_t *data, size_t len,
+                       bt_gatt_complete_func_t func, void *user_data) {
+    k_spinlock_key_t key = k_spin_lock(&links_lock);
+    if (link->in_flight >= CONFIG_APP_MIDI_LINK_MAX_IN_FLIGHT) {
+        k_spin_unlock(&links_lock, key);
+        return -EBUSY;
+    }
+    uint8_t slot = (link->head + link->in_flight) % CONFIG_APP_MIDI_LINK_MAX_IN_FLIGHT;
+    link->pending[slot] = (struct midi_pending){func, user_data};
+    link->in_flight++;
+    k_spin_unlock(&links_lock, key);
+
+    struct bt_gatt_notify_params params = {
+        .attr = &midi_ble_svc.attrs[1],
+        .data = data,
+        .len = len,
+        .func = link_notify_sent,
+        .user_data = link,
+    };
+
+    int ret = bt_gatt_notify_cb(link->conn, &params);
+    if (ret < 0) {
+        // nothing was queued after our slot, take it back
+        key = k_spin_lock(&links_lock);
+        link->in_flight--;
+        k_spin_unlock(&links_lock, key);
+    }
+    return ret;
+}
+
+int ble_midi_link_send(int idx, const uint8_t *data, size_t len, bt_gatt_complete_func_t func,
+                       void *user_data) {
+#ifdef CONFIG_APP_BENCH
+    // no radio, the notification counts as sent right away
+    ARG_UNUSED(idx);
+    diag_inc(DIAG_NOTIFY_SENT);
+    if (func) func(NULL, user_data);
+    return 0;
+#endif
+
+    if (!ble_midi_link_ready(idx)) return -ENOTCONN;
+
+    // a full link keeps its updates pending, the caller retries on completion
+    int ret = link_notify(&links[idx], data, len, func, user_data);
+    if (ret == -EBUSY || ret == -ENOMEM) {
+        diag_inc(DIAG_NOTIFY_DEFERRED);
+    } else {
+        diag_inc(ret < 0 ? DIAG_NOTIFY_DROPPED : DIAG_NOTIFY_SENT);
+    }
+    return ret;
+}
@@ -3,6 +3,7 @@
 #include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
+#include <zephyr/bluetooth/gatt.h>
 
 #define BT_UUID_REAL_MIDI_VAL BT_UUID_128_ENCODE(0x03B80E5A, 0xEDE8, 0x4B33, 0xA751, 0x6CE34EC4C700)
 #define BT_UUID_FAKE_MIDI_VAL BT_UUID_128_ENCODE(0x03B80E5A, 0xEDE8, 0x4B33, 0xA751, 0x6CE34EC4C705)
@@ -18,13 +19,37 @@
 
 struct pots_params {
     uint16_t minimum_change;
-    uint16_t slow_refresh_period_ms;
-    uint16_t fast_refresh_period_ms;
-    uint16_t fast_refresh_retention_ms;
+    uint16_t slow_refresh_period_ms;     // scan period while all pots rest
+    uint16_t fast_refresh_period_ms;     // shortest scan period
+    uint16_t fast_refresh_retention_ms;  // time constant of the motion decay
+    uint16_t latency_goal_ms;            // motion to MIDI at rest, replaces the slow period if set
+    uint8_t power_goal;                  // 0 scans the most, 100 the least while pots move
 };
 
-void ble_midi_init(void (*ble_midi_started_cb)(void));
+/* first is set when no other central had MIDI started */
+typedef void (*ble_midi_started_cb_t)(bool first);
+
+void ble_midi_init(ble_midi_started_cb_t ble_midi_started_cb);
+#ifdef CONFIG_APP_BENCH
+/* Act as if a central subscribed, packets are dropped instead of sent */
+void ble_midi_bench_start(void);
+#endif
+/* true while any central has MIDI started */
 bool ble_midi_is_started(void);
+/* Link of the next central waiting for the full pot state, -ENOENT if none */
+int ble_midi_take_sync(void);
 bool ble_midi_params_changed(void);
 void ble_midi_get_params(struct pots_params *out_params);
-int ble_midi_send_packet(const uint8_t *data, size_t len);
+/*
+ * Links are indexed 0 to CONFIG_BT_MAX_CONN - 1. A link is ready while its
+ * central has MIDI started and notifications enabled.
+ */
+bool ble_midi_link_ready(int link);
+/* Largest packet the link's central can take */
+size_t ble_midi_link_max_payload(int link);
+/*
+ * Notify one central. -EBUSY while the link has CONFIG_APP_MIDI_LINK_MAX_IN_FLIGHT
+ * notifications queued, func is called once this one has been sent.
+ */
+int ble_midi_link_send(int link, const uint8_t *data, size_t len, bt_gatt_complete_func_t func,
+                       void *user_data);
@@ -0,0 +1,321 @@
+#include "calib.h"
+
+#include <errno.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <zephyr/bluetooth/gatt.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/sys/atomic.h>
+#include <zephyr/sys/byteorder.h>
+
+#include "midi_packet.h"
+#include "mixy_uuid.h"
+#include "store.h"
+
+LOG_MODULE_REGISTER(calib, CONFIG_APP_LOG_LEVEL);
+
+// ~40 dB of range for the audio taper
+#define AUDIO_LOG_K 4.6f
+
+struct calib_table calib_tables[POTS_AMOUNT];
+uint8_t calib_ccs[POTS_AMOUNT];
+
+static const uint8_t default_ccs[POTS_AMOUNT] = {5, 3, 1, 6, 4, 2};
+
+static struct calib_record record;
+static struct k_spinlock lock;
+// pots whose table needs rebuilding
+static atomic_t rebuild_mask;
+
+enum calib_state {
+    CALIB_IDLE,
+    CALIB_NOISE,  // pots at rest, measuring noise
+    CALIB_SWEEP,  // pots being moved end to end, measuring travel
+};
+
+enum calib_run_cmd {
+    CALIB_RUN_NONE,
+    CALIB_RUN_START,
+    CALIB_RUN_FINISH,
+    CALIB_RUN_CANCEL,
+};
+
+// the run is only touched by the pipeline, GATT posts commands for calib_update()
+static atomic_t state;
+static atomic_t run_cmd;
+static uint16_t run_scans;
+static uint16_t run_prev[POTS_AMOUNT];
+static struct calib_record run;
+
+static void calib_defaults(struct calib_record *rec) {
+    for (int i = 0; i < POTS_AMOUNT; i++) {
+        rec->pots[i] = (struct pot_calib){
+            .min = 0,
+            .max = POTS_RAW_MAX,
+            .noise = 0,
+            .curve = CALIB_CURVE_LINEAR,
+            .cc = default_ccs[i],
+        };
+    }
+}
+
+static float curve_apply(enum calib_curve curve, float x) {
+    switch (curve) {
+    case CALIB_CURVE_AUDIO_LOG:
+        return (expf(AUDIO_LOG_K * x) - 1.0f) / (expf(AUDIO_LOG_K) - 1.0f);
+    case CALIB_CURVE_S:
+        return x * x * (3.0f - 2.0f * x);
+    default:
+        return x;
+    }
+}
+
+// Only runs when calibration or the curve changes, never per event
+static void table_build(int pot, const struct pot_calib *cal) {
+    struct calib_table *t = &calib_tables[pot];
+    int32_t lo = cal->min + cal->noise;
+    int32_t hi = cal->max - cal->noise;
+
+    if (hi - lo < (int32_t)(POTS_RAW_MAX / 4)) {
+        LOG_WRN("Pot %d travel %d..%d too short, using defaults", pot, lo, hi);
+        lo = 0;
+        hi = POTS_RAW_MAX;
+    }
+
+    t->lo = lo;
+    t->scale = DIV_ROUND_UP(BIT(CALIB_POS_BITS), hi - lo);
+
+    for (int i = 0; i <= CALIB_SEGMENTS; i++) {
+        float x = (float)i / CALIB_SEGMENTS;
+
+        t->knots[i] = (uint16_t)lroundf(curve_apply(cal->curve, x) * CALIB_OUT_MAX);
+    }
+
+    // saved before a switch to 14-bit output, its LSB would land on another controller
+    if (!midi_cc_assignable(cal->cc)) {
+        LOG_WRN("Pot %d CC %d not usable, using CC %d", pot, cal->cc, default_ccs[pot]);
+        calib_ccs[pot] = default_ccs[pot];
+    } else {
+        calib_ccs[pot] = cal->cc;
+    }
+}
+
+static void calib_set(const struct calib_record *rec, bool save) {
+    k_spinlock_key_t key = k_spin_lock(&lock);
+    atomic_val_t mask = 0;
+    for (int i = 0; i < POTS_AMOUNT; i++) {
+        if (memcmp(&record.pots[i], &rec->pots[i], sizeof(rec->pots[i]))) mask |= BIT(i);
+    }
+    record = *rec;
+    k_spin_unlock(&lock, key);
+
+    atomic_or(&rebuild_mask, mask);
+    if (save && mask) store_save_calib(rec);
+}
+
+void calib_init(void) {
+    calib_defaults(&record);
+    atomic_set(&rebuild_mask, BIT_MASK(POTS_AMOUNT));
+    calib_update();
+}
+
+void calib_restore(void) {
+    struct calib_record rec;
+
+    if (store_get_calib(&rec)) {
+        LOG_INF("Restored calibration");
+        calib_set(&rec, false);
+    }
+}
+
+/*     CALIBRATION RUN     */
+
+// noise is measured first with the pots left alone, then the user sweeps
+// every pot end to end and finishes the run
+bool calib_feed(const uint16_t *vals) {
+    atomic_val_t st = atomic_get(&state);
+
+    if (st == CALIB_IDLE) return false;
+
+    for (int i = 0; i < POTS_AMOUNT; i++) {
+        struct pot_calib *cal = &run.pots[i];
+        uint16_t val = (vals[i] & 0x8000) ? 0 : vals[i];
+
+        if (st == CALIB_NOISE) {
+            if (run_scans) cal->noise = MAX(cal->noise, abs(val - run_prev[i]));
+            run_prev[i] = val;
+        } else {
+            cal->min = MIN(cal->min, val);
+            cal->max = MAX(cal->max, val);
+        }
+    }
+
+    if (st == CALIB_NOISE && ++run_scans >= CONFIG_APP_CALIB_NOISE_SCANS) {
+        LOG_INF("Calibration noise measured, sweep the pots");
+        atomic_cas(&state, CALIB_NOISE, CALIB_SWEEP);
+    }
+
+    return true;
+}
+
+static void calib_run_start(void) {
+    k_spinlock_key_t key = k_spin_lock(&lock);
+    run = record;
+    k_spin_unlock(&lock, key);
+
+    for (int i = 0; i < POTS_AMOUNT; i++) {
+        run.pots[i].min = UINT16_MAX;
+        run.pots[i].max = 0;
+        run.pots[i].noise = 0;
+    }
+    run_scans = 0;
+    atomic_set(&state, CALIB_NOISE);
+}
+
+static void calib_run_finish(void) {
+    struct calib_record rec;
+
+    if (!atomic_cas(&state, CALIB_SWEEP, CALIB_IDLE)) return;
+
+    k_spinlock_key_t key = k_spin_lock(&lock);
+    rec = record;
+    k_spin_unlock(&lock, key);
+
+    // keep the previous travel of pots that were never scanned
+    for (int i = 0; i < POTS_AMOUNT; i++) {
+        if (run.pots[i].min > run.pots[i].max) {
+            run.pots[i].min = rec.pots[i].min;
+            run.pots[i].max = rec.pots[i].max;
+        }
+        // curve and CC may have been changed over GATT during the run
+        run.pots[i].curve = rec.pots[i].curve;
+        run.pots[i].cc = rec.pots[i].cc;
+    }
+
+    calib_set(&run, true);
+}
+
+void calib_update(void) {
+    switch (atomic_clear(&run_cmd)) {
+    case CALIB_RUN_START:
+        calib_run_start();
+        break;
+    case CALIB_RUN_FINISH:
+        calib_run_finish();
+        break;
+    case CALIB_RUN_CANCEL:
+        atomic_set(&state, CALIB_IDLE);
+        break;
+    default:
+        break;
+    }
+
+    atomic_val_t mask = atomic_clear(&rebuild_mask);
+    struct calib_record rec;
+
+    if (!mask) return;
+
+    k_spinlock_key_t key = k_spin_lock(&lock);
+    rec = record;
+    k_spin_unlock(&lock, key);
+
+    for (int i = 0; i < POTS_AMOUNT; i++) {
+        if (mask & BIT(i)) table_build(i, &rec.pots[i]);
+    }
+}
+
+/*     GATT     */
+
+enum calib_opcode {
+    CALIB_OP_START = 0x01,
+    CALIB_OP_FINISH = 0x02,
+    CALIB_OP_CANCEL = 0x03,
+    CALIB_OP_DEFAULTS = 0x04,
+    CALIB_OP_SET_CURVE = 0x10,  // pot, curve
+    CALIB_OP_SET_CC = 0x11,     // pot, cc
+};
+
+#define CALIB_POT_LEN 8
+
+// run state, then min, max and noise as LE16 followed by curve and CC for every pot
+static ssize_t read_calib(struct bt_conn *conn, const struct bt_gatt_attr *attr, void *buf,
+                          uint16_t len, uint16_t offset) {
+    uint8_t value[1 + POTS_AMOUNT * CALIB_POT_LEN];
+    struct calib_record rec;
+
+    k_spinlock_key_t key = k_spin_lock(&lock);
+    rec = record;
+    k_spin_unlock(&lock, key);
+
+    value[0] = atomic_get(&state);
+    for (int i = 0; i < POTS_AMOUNT; i++) {
+        uint8_t *p = &value[1 + i * CALIB_POT_LEN];
+        sys_put_le16(rec.pots[i].min, &p[0]);
+        sys_put_le16(rec.pots[i].max, &p[2]);
+        sys_put_le16(rec.pots[i].noise, &p[4]);
+        p[6] = rec.pots[i].curve;
+        p[7] = rec.pots[i].cc;
+    }
+
+    return bt_gatt_attr_read(conn, attr, buf, len, offset, value, sizeof(value));
+}
+
+static ssize_t write_calib(struct bt_conn *conn, const struct bt_gatt_attr *attr,
+                           const void *buf, uint16_t len, uint16_t offset, uint8_t flags) {
+    const uint8_t *data = buf;
+    struct calib_record rec;
+
+    if (offset || len < 1) return BT_GATT_ERR(BT_ATT_ERR_INVALID_ATTRIBUTE_LEN);
+
+    switch (data[0]) {
+    case CALIB_OP_START:
+        atomic_set(&run_cmd, CALIB_RUN_START);
+        break;
+    case CALIB_OP_FINISH:
+        if (atomic_get(&state) != CALIB_SWEEP) {
+            return BT_GATT_ERR(BT_ATT_ERR_VALUE_NOT_ALLOWED);
+        }
+        atomic_set(&run_cmd, CALIB_RUN_FINISH);
+        break;
+    case CALIB_OP_CANCEL:
+        atomic_set(&run_cmd, CALIB_RUN_CANCEL);
+        break;
+    case CALIB_OP_DEFAULTS:
+        calib_defaults(&rec);
+        calib_set(&rec, true);
+        break;
+    case CALIB_OP_SET_CURVE:
+    case CALIB_OP_SET_CC: {
+        if (len < 3 || data[1] >= POTS_AMOUNT) {
+            return BT_GATT_ERR(BT_ATT_ERR_VALUE_NOT_ALLOWED);
+        }
+        if (data[0] == CALIB_OP_SET_CURVE ? data[2] >= CALIB_CURVE_COUNT
+                                          : !midi_cc_assignable(data[2])) {
+            return BT_GATT_ERR(BT_ATT_ERR_VALUE_NOT_ALLOWED);
+        }
+
+        k_spinlock_key_t key = k_spin_lock(&lock);
+        rec = record;
+        k_spin_unlock(&lock, key);
+
+        if (data[0] == CALIB_OP_SET_CURVE) {
+            rec.pots[data[1]].curve = data[2];
+        } else {
+            rec.pots[data[1]].cc = data[2];
+        }
+        calib_set(&rec, true);
+        break;
+    }
+    default:
+        return BT_GATT_ERR(BT_ATT_ERR_NOT_SUPPORTED);
+    }
+
+    return len;
+}
+
+BT_GATT_SERVICE_DEFINE(calib_svc,
+                       BT_GATT_PRIMARY_SERVICE(BT_UUID_MIXY_CALIB_SVC),
+                       BT_GATT_CHARACTERISTIC(BT_UUID_MIXY_CALIB_CHAR, BT_GATT_CHRC_READ | BT_GATT_CHRC_WRITE,
+                                              BT_GATT_PERM_READ | BT_GATT_PERM_WRITE, read_calib, write_calib, NULL), );
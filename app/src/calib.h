@@ -0,0 +1,90 @@
+#pragma once
+
+#include <app/drivers/pots.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <zephyr/sys/util.h>
+
+#define POTS_AMOUNT POTS_FRAME_LEN
+
+// full travel reads ~930 at 10 bits, scale that to the configured resolution
+#define POTS_RAW_SHIFT (CONFIG_POTS_RESOLUTION - 10)
+#define POTS_RAW_MAX (930 << POTS_RAW_SHIFT)
+
+// the curve is sampled at 2^N + 1 knots and interpolated linearly between them
+#define CALIB_SEGMENT_BITS CONFIG_APP_CALIB_SEGMENT_BITS
+#define CALIB_SEGMENTS BIT(CALIB_SEGMENT_BITS)
+// travel position fraction bits
+#define CALIB_POS_BITS 24
+
+// full scale of the curve output, 14 bits
+#define CALIB_OUT_MAX 0x3FFF
+
+enum calib_curve {
+    CALIB_CURVE_LINEAR,
+    CALIB_CURVE_AUDIO_LOG,
+    CALIB_CURVE_S,
+    CALIB_CURVE_COUNT,
+};
+
+struct pot_calib {
+    uint16_t min;
+    uint16_t max;
+    uint16_t noise;  // peak to peak at rest, trimmed off both ends of travel
+    uint8_t curve;
+    uint8_t cc;
+};
+
+struct calib_record {
+    struct pot_calib pots[POTS_AMOUNT];
+};
+
+// One pot's curve, built from its calibration
+struct calib_table {
+    int32_t lo;
+    uint32_t scale;  // 2^CALIB_POS_BITS over the usable travel
+    uint16_t knots[CALIB_SEGMENTS + 1];
+};
+
+extern struct calib_table calib_tables[POTS_AMOUNT];
+extern uint8_t calib_ccs[POTS_AMOUNT];
+
+/* Raw sample to a 14-bit output value on the pot's curve */
+static inline uint16_t calib_map(int pot, uint16_t raw) {
+    const struct calib_table *t = &calib_tables[pot];
+
+    // the SAADC reports slightly negative values around ground
+    if (raw & 0x8000) raw = 0;
+
+    int64_t pos = ((int64_t)raw - t->lo) * t->scale;
+    pos = CLAMP(pos, 0, BIT(CALIB_POS_BITS));
+
+    uint32_t seg = pos >> (CALIB_POS_BITS - CALIB_SEGMENT_BITS);
+    if (seg >= CALIB_SEGMENTS) return t->knots[CALIB_SEGMENTS];
+
+    // 16 bits of the position within the segment
+    uint32_t frac = (pos >> (CALIB_POS_BITS - CALIB_SEGMENT_BITS - 16)) & 0xFFFF;
+    int32_t k0 = t->knots[seg];
+    int32_t k1 = t->knots[seg + 1];
+
+    return k0 + (((k1 - k0) * (int32_t)frac) >> 16);
+}
+
+static inline uint8_t calib_cc(int pot) {
+    return calib_ccs[pot];
+}
+
+/* Build the tables from the defaults */
+void calib_init(void);
+
+/* Apply calibration restored from the settings storage, if any */
+void calib_restore(void);
+
+/*
+ * Apply calibration changes and run commands from GATT, call from the
+ * context using calib_map() and calib_feed()
+ */
+void calib_update(void);
+
+/* Feed a scan, returns true while a calibration run consumes the scans */
+bool calib_feed(const uint16_t *vals);
@@ -0,0 +1,226 @@
+#include "conn_params.h"
+
+#include <errno.h>
+#include <zephyr/bluetooth/bluetooth.h>
+#include <zephyr/bluetooth/conn.h>
+#include <zephyr/bluetooth/gatt.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/sys/byteorder.h>
+
+#include "diag.h"
+#include "mixy_uuid.h"
+
+LOG_MODULE_REGISTER(conn_params, CONFIG_APP_LOG_LEVEL);
+
+enum conn_profile {
+    CONN_PROFILE_IDLE,
+    CONN_PROFILE_ACTIVE,
+};
+
+static const struct bt_le_conn_param profiles[] = {
+    [CONN_PROFILE_IDLE] = BT_LE_CONN_PARAM_INIT(CONFIG_APP_CONN_IDLE_MIN_INT,
+                                                CONFIG_APP_CONN_IDLE_MAX_INT,
+                                                CONFIG_APP_CONN_IDLE_LATENCY,
+                                                CONFIG_APP_CONN_IDLE_TIMEOUT),
+    [CONN_PROFILE_ACTIVE] = BT_LE_CONN_PARAM_INIT(CONFIG_APP_CONN_ACTIVE_MIN_INT,
+                                                  CONFIG_APP_CONN_ACTIVE_MAX_INT,
+                                                  CONFIG_APP_CONN_ACTIVE_LATENCY,
+                                                  CONFIG_APP_CONN_ACTIVE_TIMEOUT),
+};
+
+static struct bt_conn *current_conn;
+static struct conn_params_info current;
+static enum conn_profile wanted = CONN_PROFILE_IDLE;
+
+static bool awaiting_update;
+static int64_t last_request_time;
+static uint32_t backoff_ms;
+
+static void update_work_handler(struct k_work *work);
+static K_WORK_DELAYABLE_DEFINE(update_work, update_work_handler);
+
+static bool profile_applied(enum conn_profile profile) {
+    const struct bt_le_conn_param *param = &profiles[profile];
+
+    return current.interval >= param->interval_min && current.interval <= param->interval_max &&
+           current.latency == param->latency;
+}
+
+// Centrals that reject or ignore us get asked less and less often
+static void backoff_increase(void) {
+    backoff_ms = CLAMP(backoff_ms * 2, CONFIG_APP_CONN_PARAMS_MIN_SPACING_MS,
+                       CONFIG_APP_CONN_PARAMS_MAX_BACKOFF_MS);
+}
+
+static void update_work_handler(struct k_work *work) {
+    if (!current_conn) return;
+
+    if (profile_applied(wanted)) {
+        awaiting_update = false;
+        return;
+    }
+
+    int64_t since_request = k_uptime_get() - last_request_time;
+
+    if (awaiting_update) {
+        // no matching update within the response window, central turned it down
+        awaiting_update = false;
+        LOG_DBG("Connection parameter request ignored");
+        diag_inc(DIAG_CONN_PARAM_REJECTS);
+        backoff_increase();
+    }
+
+    uint32_t spacing = MAX(CONFIG_APP_CONN_PARAMS_MIN_SPACING_MS, backoff_ms);
+    if (since_request < spacing) {
+        k_work_reschedule(&update_work, K_MSEC(spacing - since_request));
+        return;
+    }
+
+    last_request_time = k_uptime_get();
+
+    int err = bt_conn_le_param_update(current_conn, &profiles[wanted]);
+    if (err == -EALREADY) {
+        return;
+    } else if (err) {
+        LOG_WRN("Connection parameter request failed (err %d)", err);
+        diag_inc(DIAG_CONN_PARAM_REJECTS);
+        backoff_increase();
+        k_work_reschedule(&update_work, K_MSEC(backoff_ms));
+        return;
+    }
+
+    awaiting_update = true;
+    k_work_reschedule(&update_work, K_MSEC(CONFIG_APP_CONN_PARAMS_RESPONSE_TIMEOUT_MS));
+}
+
+void conn_params_set_active(bool active) {
+    enum conn_profile profile = active ? CONN_PROFILE_ACTIVE : CONN_PROFILE_IDLE;
+
+    if (profile == wanted) return;
+
+    wanted = profile;
+    awaiting_update = false;
+    if (current_conn) {
+        k_work_reschedule(&update_work, K_NO_WAIT);
+    }
+}
+
+void conn_params_get(struct conn_params_info *info) {
+    *info = current;
+}
+
+/*     GATT     */
+
+#define CONN_PARAMS_VALUE_LEN 7
+
+static void encode_conn_params(uint8_t *value) {
+    sys_put_le16(current.interval, &value[0]);
+    sys_put_le16(current.latency, &value[2]);
+    sys_put_le16(current.timeout, &value[4]);
+    value[6] = wanted;
+}
+
+static ssize_t read_conn_params(struct bt_conn *conn, const struct bt_gatt_attr *attr, void *buf,
+                                uint16_t len, uint16_t offset) {
+    uint8_t value[CONN_PARAMS_VALUE_LEN];
+
+    encode_conn_params(value);
+    return bt_gatt_attr_read(conn, attr, buf, len, offset, value, sizeof(value));
+}
+
+BT_GATT_SERVICE_DEFINE(conn_params_svc,
+                       BT_GATT_PRIMARY_SERVICE(BT_UUID_MIXY_CONN_PARAMS_SVC),
+                       BT_GATT_CHARACTERISTIC(BT_UUID_MIXY_CONN_PARAMS_CHAR, BT_GATT_CHRC_READ | BT_GATT_CHRC_NOTIFY,
+                                              BT_GATT_PERM_READ, read_conn_params, NULL, NULL),
+                       BT_GATT_CCC(NULL, BT_GATT_PERM_READ | BT_GATT_PERM_WRITE), );
+
+static void notify_conn_params(void) {
+    uint8_t value[CONN_PARAMS_VALUE_LEN];
+
+    encode_conn_params(value);
+
+    // fails harmlessly when nobody subscribed
+    bt_gatt_notify(NULL, &conn_params_svc.attrs[1], value, sizeof(value));
+}
+
+/*     CONNECTION CALLBACKS     */
+
+// Starts managing conn, delay_ms gives the central time before the first request
+static void conn_adopt(struct bt_conn *conn, uint32_t delay_ms) {
+    struct bt_conn_info info;
+
+    if (bt_conn_get_info(conn, &info) == 0) {
+        current.interval = info.le.interval;
+        current.latency = info.le.latency;
+        current.timeout = info.le.timeout;
+    }
+
+    current_conn = bt_conn_ref(conn);
+    awaiting_update = false;
+    backoff_ms = 0;
+    last_request_time = k_uptime_get();
+
+    k_work_reschedule(&update_work, K_MSEC(delay_ms));
+}
+
+static void connected(struct bt_conn *conn, uint8_t err) {
+    if (err || current_conn) return;
+
+    wanted = CONN_PROFILE_IDLE;
+    // give the central time to finish discovery before asking for anything
+    conn_adopt(conn, CONFIG_APP_CONN_PARAMS_INITIAL_DELAY_MS);
+}
+
+static void adopt_remaining(struct bt_conn *conn, void *user_data) {
+    struct bt_conn *gone = user_data;
+    struct bt_conn_info info;
+
+    if (current_conn || conn == gone) return;
+    if (bt_conn_get_info(conn, &info) || info.state != BT_CONN_STATE_CONNECTED) return;
+
+    // past discovery already, the wanted profile still applies
+    conn_adopt(conn, 0);
+}
+
+static void disconnected(struct bt_conn *conn, uint8_t reason) {
+    if (conn != current_conn) return;
+
+    k_work_cancel_delayable(&update_work);
+    bt_conn_unref(current_conn);
+    current_conn = NULL;
+
+    // another central may still be connected, manage that one from now on
+    bt_conn_foreach(BT_CONN_TYPE_LE, adopt_remaining, conn);
+}
+
+static void le_param_updated(struct bt_conn *conn, uint16_t interval, uint16_t latency,
+                             uint16_t timeout) {
+    if (conn != current_conn) return;
+
+    LOG_DBG("Connection parameters: interval %u, latency %u, timeout %u", interval, latency,
+            timeout);
+
+    current.interval = interval;
+    current.latency = latency;
+    current.timeout = timeout;
+    diag_inc(DIAG_CONN_PARAM_UPDATES);
+    notify_conn_params();
+
+    if (profile_applied(wanted)) {
+        awaiting_update = false;
+        backoff_ms = 0;
+    } else if (awaiting_update) {
+        LOG_DBG("Central chose different connection parameters");
+        diag_inc(DIAG_CONN_PARAM_REJECTS);
+        awaiting_update = false;
+        backoff_increase();
+        k_work_reschedule(&update_work, K_MSEC(backoff_ms));
+    }
+}
+
+BT_CONN_CB_DEFINE(conn_params_callbacks) = {
+    .connected = connected,
+    .disconnected = disconnected,
+    .le_param_updated = le_param_updated,
+};
@@ -0,0 +1,15 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+struct conn_params_info {
+    uint16_t interval;  // 1.25 ms units
+    uint16_t latency;
+    uint16_t timeout;   // 10 ms units
+};
+
+/* Ask for the short interval while pots are moving, the long one otherwise */
+void conn_params_set_active(bool active);
+
+void conn_params_get(struct conn_params_info *info);
@@ -0,0 +1,125 @@
+#include "conn_sync.h"
+
+#include <zephyr/bluetooth/bluetooth.h>
+#include <zephyr/bluetooth/conn.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/sys/util.h>
+
+LOG_MODULE_REGISTER(conn_sync, CONFIG_APP_LOG_LEVEL);
+
+// completions before the phase is trusted
+#define SYNC_MIN_SAMPLES 4
+// the phase follows 1/2^N of every completion's error
+#define SYNC_AVG_SHIFT 2
+
+static struct k_spinlock lock;
+static struct bt_conn *sync_conn;
+static int64_t interval_ticks;
+// uptime ticks of one completion, moved along with every later one
+static int64_t phase_ticks;
+static uint8_t samples;
+
+static void sync_restart(uint16_t interval) {
+    // 1.25 ms units
+    interval_ticks = k_us_to_ticks_near64(interval * 1250U);
+    samples = 0;
+}
+
+void conn_sync_notify_done(struct bt_conn *conn) {
+    int64_t now = k_uptime_ticks();
+
+    k_spinlock_key_t key = k_spin_lock(&lock);
+
+    if (conn == sync_conn && interval_ticks) {
+        if (samples == 0) {
+            phase_ticks = now;
+        } else {
+            // error against the nearest predicted event, in (-interval/2, interval/2]
+            int64_t err = (now - phase_ticks) % interval_ticks;
+            if (err > interval_ticks / 2) err -= interval_ticks;
+            if (err < -interval_ticks / 2) err += interval_ticks;
+
+            // several notifications in one event report late, move to earlier ones quickly
+            phase_ticks = now - err + (err < 0 ? err : err >> SYNC_AVG_SHIFT);
+        }
+        if (samples < SYNC_MIN_SAMPLES) samples++;
+    }
+
+    k_spin_unlock(&lock, key);
+}
+
+k_timeout_t conn_sync_delay(uint32_t period_ms) {
+    int64_t now = k_uptime_ticks();
+    int64_t lead = k_us_to_ticks_ceil64(CONFIG_APP_CONN_SYNC_LEAD_US);
+    int64_t target = now + k_ms_to_ticks_ceil64(period_ms);
+
+    k_spinlock_key_t key = k_spin_lock(&lock);
+    bool synced = samples >= SYNC_MIN_SAMPLES;
+    int64_t interval = interval_ticks;
+    int64_t phase = phase_ticks;
+    k_spin_unlock(&lock, key);
+
+    if (!synced) return K_MSEC(period_ms);
+
+    // the first event that still leaves the lead time after the target
+    int64_t since = target + lead - phase;
+    int64_t events = since > 0 ? DIV_ROUND_UP(since, interval) : since / interval;
+    int64_t at = phase + events * interval - lead;
+
+    // take the event before if that is closer and not in the past
+    if (at - target > interval / 2 && at - interval >= now) at -= interval;
+
+    return K_TICKS(MAX(at - now, 0));
+}
+
+/*     CONNECTION CALLBACKS     */
+
+static void connected(struct bt_conn *conn, uint8_t err) {
+    struct bt_conn_info info;
+
+    if (err || sync_conn) return;
+    if (bt_conn_get_info(conn, &info) || info.state != BT_CONN_STATE_CONNECTED) return;
+
+    k_spinlock_key_t key = k_spin_lock(&lock);
+    sync_conn = bt_conn_ref(conn);
+    sync_restart(info.le.interval);
+    k_spin_unlock(&lock, key);
+}
+
+static void adopt_remaining(struct bt_conn *conn, void *user_data) {
+    if (conn != user_data) connected(conn, 0);
+}
+
+static void disconnected(struct bt_conn *conn, uint8_t reason) {
+    if (conn != sync_conn) return;
+
+    k_spinlock_key_t key = k_spin_lock(&lock);
+    sync_conn = NULL;
+    interval_ticks = 0;
+    samples = 0;
+    k_spin_unlock(&lock, key);
+
+    bt_conn_unref(conn);
+
+    // follow a central that is still connected
+    bt_conn_foreach(BT_CONN_TYPE_LE, adopt_remaining, conn);
+}
+
+// the anchor moves with every parameter update
+static void le_param_updated(struct bt_conn *conn, uint16_t interval, uint16_t latency,
+                             uint16_t timeout) {
+    if (conn != sync_conn) return;
+
+    k_spinlock_key_t key = k_spin_lock(&lock);
+    sync_restart(interval);
+    k_spin_unlock(&lock, key);
+
+    LOG_DBG("Resynchronizing to a %u us interval", interval * 1250U);
+}
+
+BT_CONN_CB_DEFINE(conn_sync_callbacks) = {
+    .connected = connected,
+    .disconnected = disconnected,
+    .le_param_updated = le_param_updated,
+};
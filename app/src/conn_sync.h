@@ -0,0 +1,32 @@
+#pragma once
+
+#include <stdint.h>
+#include <zephyr/bluetooth/conn.h>
+#include <zephyr/kernel.h>
+
+#ifdef CONFIG_APP_CONN_SYNC
+
+/*
+ * Connection event phase of the first central, estimated from notification
+ * completions. The stack reports those right after the event that carried
+ * them, so their phase modulo the interval follows the event anchor.
+ */
+
+/* A notification to conn completed, call from its completion callback */
+void conn_sync_notify_done(struct bt_conn *conn);
+
+/*
+ * Delay for a scan wanted in period_ms, moved to CONFIG_APP_CONN_SYNC_LEAD_US
+ * before the nearest connection event once the phase is known
+ */
+k_timeout_t conn_sync_delay(uint32_t period_ms);
+
+#else
+
+static inline void conn_sync_notify_done(struct bt_conn *conn) {}
+
+static inline k_timeout_t conn_sync_delay(uint32_t period_ms) {
+    return K_MSEC(period_ms);
+}
+
+#endif
@@ -0,0 +1,46 @@
+#include <app/drivers/ext_power.h>
+#include <zephyr/bluetooth/bluetooth.h>
+#include <zephyr/bluetooth/gatt.h>
+#include <zephyr/device.h>
+#include <zephyr/kernel.h>
+#include <zephyr/sys/byteorder.h>
+
+#include "diag.h"
+#include "latency.h"
+#include "mixy_uuid.h"
+
+atomic_t diag_counters[DIAG_COUNTER_COUNT];
+
+static const struct device *const ext_power = DEVICE_DT_GET(DT_NODELABEL(ext_power));
+
+// All counters as little endian uint32, in enum diag_counter order
+static ssize_t read_counters(struct bt_conn *conn, const struct bt_gatt_attr *attr, void *buf,
+                             uint16_t len, uint16_t offset) {
+    uint8_t value[DIAG_COUNTER_COUNT * sizeof(uint32_t)];
+
+    atomic_set(&diag_counters[DIAG_EXT_POWER_ON_MS], ext_power_get_on_time_ms(ext_power));
+    atomic_set(&diag_counters[DIAG_EXT_POWER_ON_COUNT], ext_power_get_on_count(ext_power));
+
+    for (int i = 0; i < DIAG_COUNTER_COUNT; i++) {
+        sys_put_le32(atomic_get(&diag_counters[i]), &value[i * sizeof(uint32_t)]);
+    }
+
+    return bt_gatt_attr_read(conn, attr, buf, len, offset, value, sizeof(value));
+}
+
+// Any write resets the counters, the ext_power on-time and count are running totals
+static ssize_t write_counters(struct bt_conn *conn, const struct bt_gatt_attr *attr,
+                              const void *buf, uint16_t len, uint16_t offset, uint8_t flags) {
+    for (int i = 0; i < DIAG_COUNTER_COUNT; i++) {
+        atomic_clear(&diag_counters[i]);
+    }
+    return len;
+}
+
+BT_GATT_SERVICE_DEFINE(diag_svc,
+                       BT_GATT_PRIMARY_SERVICE(BT_UUID_MIXY_DIAG_SVC),
+                       BT_GATT_CHARACTERISTIC(BT_UUID_MIXY_DIAG_COUNTERS_CHAR, BT_GATT_CHRC_READ | BT_GATT_CHRC_WRITE,
+                                              BT_GATT_PERM_READ | BT_GATT_PERM_WRITE, read_counters, write_counters, NULL),
+                       IF_ENABLED(CONFIG_APP_LATENCY_HIST, (
+                       BT_GATT_CHARACTERISTIC(BT_UUID_MIXY_DIAG_LATENCY_CHAR, BT_GATT_CHRC_READ | BT_GATT_CHRC_WRITE,
+                                              BT_GATT_PERM_READ | BT_GATT_PERM_WRITE, latency_read_hists, latency_write_hists, NULL),)) );
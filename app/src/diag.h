@@ -0,0 +1,55 @@
+#pragma once
+
+#include <stdint.h>
+#include <zephyr/sys/atomic.h>
+
+enum diag_counter {
+    DIAG_SCANS,
+    DIAG_ADC_TIME_US,
+    DIAG_EXT_POWER_ON_MS,  // filled from the ext_power driver on read
+    DIAG_NOTIFY_SENT,
+    DIAG_NOTIFY_DROPPED,  // refused for good, e.g. the link went away meanwhile
+    DIAG_WORK_LATENCY_TOTAL_US,
+    DIAG_WORK_LATENCY_MAX_US,
+    DIAG_FAST_REFRESH_MS,
+    DIAG_SLOW_REFRESH_MS,
+    DIAG_CONN_PARAM_UPDATES,
+    DIAG_CONN_PARAM_REJECTS,
+    DIAG_MIDI_EVENTS,
+    DIAG_MIDI_BYTES,
+    DIAG_SCAN_CPU_US,
+    DIAG_QUEUE_DEPTH_MAX,    // pipeline items due at once, see pipeline.h
+    DIAG_QUEUE_LATE_MAX_US,  // worst delay of any pipeline item past its due time
+    DIAG_EXT_POWER_ON_COUNT,  // filled from the ext_power driver on read
+    DIAG_NOTIFY_DEFERRED,     // link full, the updates stay pending and go out later
+    DIAG_COUNTER_COUNT,
+};
+
+#ifdef CONFIG_APP_DIAG
+
+extern atomic_t diag_counters[DIAG_COUNTER_COUNT];
+
+static inline void diag_add(enum diag_counter counter, uint32_t value) {
+    atomic_add(&diag_counters[counter], value);
+}
+
+static inline void diag_inc(enum diag_counter counter) {
+    atomic_inc(&diag_counters[counter]);
+}
+
+static inline void diag_max(enum diag_counter counter, uint32_t value) {
+    atomic_val_t old;
+
+    do {
+        old = atomic_get(&diag_counters[counter]);
+        if ((uint32_t)old >= value) return;
+    } while (!atomic_cas(&diag_counters[counter], old, value));
+}
+
+#else
+
+static inline void diag_add(enum diag_counter counter, uint32_t value) {}
+static inline void diag_inc(enum diag_counter counter) {}
+static inline void diag_max(enum diag_counter counter, uint32_t value) {}
+
+#endif
@@ -0,0 +1,132 @@
+#include <zephyr/bluetooth/bluetooth.h>
+#include <zephyr/bluetooth/gatt.h>
+#include <zephyr/kernel.h>
+#include <zephyr/sys/byteorder.h>
+#include <zephyr/sys/util.h>
+
+#include "latency.h"
+
+// Upper bucket edges in ms, the last bucket takes everything above
+static const uint16_t bucket_edges_ms[] = {1, 2, 3, 5, 7, 10, 15, 20, 30, 50, 70, 100, 150, 200, 300, 500};
+
+#define LATENCY_BUCKETS (ARRAY_SIZE(bucket_edges_ms) + 1)
+
+static atomic_t hists[LATENCY_HIST_COUNT][LATENCY_BUCKETS];
+
+// Notifications in flight, matched to their completion through the token
+struct latency_record {
+    uint32_t sample_ms;
+    uint32_t enqueue_ms;
+    bool used;
+};
+
+static struct latency_record records[CONFIG_APP_LATENCY_HIST_IN_FLIGHT];
+static struct k_spinlock records_lock;
+
+static void hist_add(enum latency_hist hist, uint32_t value_ms) {
+    int bucket = 0;
+
+    while (bucket < ARRAY_SIZE(bucket_edges_ms) && value_ms >= bucket_edges_ms[bucket]) {
+        bucket++;
+    }
+    atomic_inc(&hists[hist][bucket]);
+}
+
+void *latency_enqueue(uint32_t sample_ms) {
+    uint32_t now = k_uptime_get_32();
+    struct latency_record *record = NULL;
+
+    k_spinlock_key_t key = k_spin_lock(&records_lock);
+    for (int i = 0; i < ARRAY_SIZE(records); i++) {
+        if (!records[i].used) {
+            record = &records[i];
+            record->used = true;
+            record->sample_ms = sample_ms;
+            record->enqueue_ms = now;
+            break;
+        }
+    }
+    k_spin_unlock(&records_lock, key);
+
+    hist_add(LATENCY_SAMPLE_TO_ENQUEUE, now - sample_ms);
+    return record;
+}
+
+void latency_cancel(void *token) {
+    struct latency_record *record = token;
+
+    if (!record) return;
+
+    k_spinlock_key_t key = k_spin_lock(&records_lock);
+    record->used = false;
+    k_spin_unlock(&records_lock, key);
+}
+
+void latency_notify_complete(struct bt_conn *conn, void *user_data) {
+    struct latency_record *record = user_data;
+    uint32_t now = k_uptime_get_32();
+
+    if (!record) return;
+
+    hist_add(LATENCY_ENQUEUE_TO_AIR, now - record->enqueue_ms);
+    hist_add(LATENCY_TOTAL, now - record->sample_ms);
+
+    k_spinlock_key_t key = k_spin_lock(&records_lock);
+    record->used = false;
+    k_spin_unlock(&records_lock, key);
+}
+
+// Upper edge of the bucket holding the given percentile, 0xFFFF past the last edge
+static uint16_t hist_percentile(const uint32_t *counts, uint32_t total, int percent) {
+    uint32_t target = DIV_ROUND_UP(total * percent, 100);
+    uint32_t seen = 0;
+
+    for (int i = 0; i < LATENCY_BUCKETS; i++) {
+        seen += counts[i];
+        if (seen >= target && total) {
+            return i < ARRAY_SIZE(bucket_edges_ms) ? bucket_edges_ms[i] : UINT16_MAX;
+        }
+    }
+    return 0;
+}
+
+/*
+ * Per histogram: p50 and p99 as uint16 ms, then the bucket counts as uint32,
+ * all little endian. Bucket edges are listed in bucket_edges_ms.
+ */
+ssize_t latency_read_hists(struct bt_conn *conn, const struct bt_gatt_attr *attr, void *buf,
+                           uint16_t len, uint16_t offset) {
+    uint8_t value[LATENCY_HIST_COUNT * (2 * sizeof(uint16_t) + LATENCY_BUCKETS * sizeof(uint32_t))];
+    uint8_t *pos = value;
+
+    for (int h = 0; h < LATENCY_HIST_COUNT; h++) {
+        uint32_t counts[LATENCY_BUCKETS];
+        uint32_t total = 0;
+
+        for (int i = 0; i < LATENCY_BUCKETS; i++) {
+            counts[i] = atomic_get(&hists[h][i]);
+            total += counts[i];
+        }
+
+        sys_put_le16(hist_percentile(counts, total, 50), pos);
+        sys_put_le16(hist_percentile(counts, total, 99), pos + 2);
+        pos += 4;
+
+        for (int i = 0; i < LATENCY_BUCKETS; i++) {
+            sys_put_le32(counts[i], pos);
+            pos += 4;
+        }
+    }
+
+    return bt_gatt_attr_read(conn, attr, buf, len, offset, value, sizeof(value));
+}
+
+ssize_t latency_write_hists(struct bt_conn *conn, const struct bt_gatt_attr *attr,
+                            const void *buf, uint16_t len, uint16_t offset, uint8_t flags) {
+    for (int h = 0; h < LATENCY_HIST_COUNT; h++) {
+        for (int i = 0; i < LATENCY_BUCKETS; i++) {
+            atomic_clear(&hists[h][i]);
+        }
+    }
+    return len;
+}
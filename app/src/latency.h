@@ -0,0 +1,42 @@
+#pragma once
+
+#include <stdint.h>
+#include <sys/types.h>
+#include <zephyr/bluetooth/conn.h>
+#include <zephyr/bluetooth/gatt.h>
+
+enum latency_hist {
+    LATENCY_SAMPLE_TO_ENQUEUE,
+    LATENCY_ENQUEUE_TO_AIR,
+    LATENCY_TOTAL,
+    LATENCY_HIST_COUNT,
+};
+
+#ifdef CONFIG_APP_LATENCY_HIST
+
+/* Start tracking a packet holding events sampled at sample_ms, returns a token or NULL */
+void *latency_enqueue(uint32_t sample_ms);
+
+/* The notification could not be queued, forget it */
+void latency_cancel(void *token);
+
+/* bt_gatt_complete_func_t, pass the token from latency_enqueue() as user_data */
+void latency_notify_complete(struct bt_conn *conn, void *user_data);
+
+/* GATT handlers for the diagnostics service, a write clears the histograms */
+ssize_t latency_read_hists(struct bt_conn *conn, const struct bt_gatt_attr *attr, void *buf,
+                           uint16_t len, uint16_t offset);
+ssize_t latency_write_hists(struct bt_conn *conn, const struct bt_gatt_attr *attr,
+                            const void *buf, uint16_t len, uint16_t offset, uint8_t flags);
+
+#else
+
+static inline void *latency_enqueue(uint32_t sample_ms) {
+    return NULL;
+}
+
+static inline void latency_cancel(void *token) {}
+
+#define latency_notify_complete NULL
+
+#endif
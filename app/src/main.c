@@ -1,4 +1,5 @@
 #include <app/drivers/pots.h>
+#include <errno.h>
 #include <stddef.h>
 #include <string.h>
 #include <zephyr/bluetooth/bluetooth.h>
@@ -11,18 +12,31 @@
 #include <zephyr/drivers/sensor.h>
 #include <zephyr/kernel.h>
 #include <zephyr/logging/log.h>
+#include <zephyr/settings/settings.h>
 #include <zephyr/types.h>
 
+#include "bench.h"
 #include "ble_midi.h"
+#include "calib.h"
+#include "conn_params.h"
+#include "conn_sync.h"
+#include "diag.h"
+#include "midi_out.h"
+#include "pipeline.h"
+#include "pots_filter.h"
+#include "sched.h"
+#include "store.h"
 
 LOG_MODULE_REGISTER(main, CONFIG_APP_LOG_LEVEL);
 
-static void ble_midi_started(void);
+static void ble_midi_started(bool first);
 static void pots_data_task(struct k_work *work);
 static void bas_notify_task(struct k_work *work);
+static bool pots_sampling_suspend(void);
+static void pots_sampling_resume(void);
 
-static K_WORK_DELAYABLE_DEFINE(data_out_work, pots_data_task);
-static K_WORK_DELAYABLE_DEFINE(battery_update_work, bas_notify_task);
+static struct pipeline_work data_out_work;
+static struct pipeline_work battery_update_work;
 
 /*     BLUETOOTH    */
 
@@ -41,38 +55,94 @@ static const struct bt_data ad[] = {
 
 #define BT_LE_ADV_PARAMS BT_LE_ADV_PARAM(BT_LE_ADV_OPT_CONN, 0x960, 0xC80, NULL)  // 1.5s to 2s interval
 
-static bool bt_connected = false;
+static atomic_t connections;
+
+static void mtu_exchanged(struct bt_conn *conn, uint8_t err,
+                          struct bt_gatt_exchange_params *params) {
+    if (err) {
+        LOG_WRN("MTU exchange failed (err %u)", err);
+    } else {
+        LOG_DBG("MTU %u", bt_gatt_get_mtu(conn));
+    }
+}
+
+static struct bt_gatt_exchange_params mtu_exchange_params = {
+    .func = mtu_exchanged,
+};
+
+// Ask for everything that shortens radio-on time per notification.
+// Each procedure is optional, centrals that do not support one reject it
+// and the link simply stays on the default for it.
+static void link_negotiate(struct bt_conn *conn) {
+    int err;
+
+    err = bt_conn_le_phy_update(conn, BT_CONN_LE_PHY_PARAM_2M);
+    if (err) {
+        LOG_WRN("PHY update request failed (err %d)", err);
+    }
+
+    err = bt_conn_le_data_len_update(conn, BT_LE_DATA_LEN_PARAM_MAX);
+    if (err) {
+        LOG_WRN("Data length update request failed (err %d)", err);
+    }
+
+    // the central may have started the exchange already
+    err = bt_gatt_exchange_mtu(conn, &mtu_exchange_params);
+    if (err && err != -EALREADY) {
+        LOG_WRN("MTU exchange request failed (err %d)", err);
+    }
+}
+
+static void adv_start(void) {
+    int err = bt_le_adv_start(BT_LE_ADV_PARAMS, ad, ARRAY_SIZE(ad), NULL, 0);
+    if (err && err != -EALREADY) {
+        LOG_ERR("Advertising failed to start (err %d)", err);
+        return;
+    }
+
+    LOG_DBG("Advertising restarted");
+}
 
 static void connected(struct bt_conn *conn, uint8_t err) {
     if (err) {
         LOG_ERR("Connection failed, err 0x%02x", err);
     } else {
         LOG_INF("Connected");
-        bt_connected = true;
-        k_work_schedule(&battery_update_work, K_NO_WAIT);
+        atomic_inc(&connections);
+        link_negotiate(conn);
+        pipeline_schedule(&battery_update_work, K_NO_WAIT);
+    }
+
+    // stay connectable for the next central while there is room for one
+    if (atomic_get(&connections) < CONFIG_BT_MAX_CONN) {
+        adv_start();
     }
 }
 
 static void disconnected(struct bt_conn *conn, uint8_t reason) {
     LOG_INF("Disconnected, reason 0x%02x %s", reason, bt_hci_err_to_str(reason));
-    bt_connected = false;
+    atomic_dec(&connections);
 }
 
 static void bt_recycled() {
     LOG_DBG("Connection recycled");
-    int err = bt_le_adv_start(BT_LE_ADV_PARAMS, ad, ARRAY_SIZE(ad), NULL, 0);
-    if (err) {
-        LOG_ERR("Advertising failed to start (err %d)", err);
-        return;
-    }
+    adv_start();
+}
 
-    LOG_DBG("Advertising restarted");
+static void le_phy_updated(struct bt_conn *conn, struct bt_conn_le_phy_info *param) {
+    LOG_DBG("PHY TX %u RX %u", param->tx_phy, param->rx_phy);
+}
+
+static void le_data_len_updated(struct bt_conn *conn, struct bt_conn_le_data_len_info *info) {
+    LOG_DBG("Data length TX %u RX %u", info->tx_max_len, info->rx_max_len);
 }
 
 BT_CONN_CB_DEFINE(conn_callbacks) = {
     .connected = connected,
     .disconnected = disconnected,
-    .recycled = bt_recycled};
+    .recycled = bt_recycled,
+    .le_phy_updated = le_phy_updated,
+    .le_data_len_updated = le_data_len_updated};
 
 static void bt_ready(void) {
     LOG_INF("Bluetooth initialized");
@@ -89,13 +159,18 @@ static void bt_ready(void) {
 }
 
 /*     BATTERY    */
+#if DT_HAS_CHOSEN(mixy_battery)
 static const struct device *const battery = DEVICE_DT_GET(DT_CHOSEN(mixy_battery));
 
 static void bas_notify_task(struct k_work *work) {
     struct sensor_value state_of_charge;
     int ret;
 
+    pipeline_begin(work);
+
+    bool resume = pots_sampling_suspend();
     ret = sensor_sample_fetch_chan(battery, SENSOR_CHAN_GAUGE_STATE_OF_CHARGE);
+    if (resume) pots_sampling_resume();
     if (ret != 0) {
         LOG_INF("Failed to fetch battery values: %d", ret);
         return;
@@ -113,130 +188,234 @@ static void bas_notify_task(struct k_work *work) {
         // keep trying
     }
 
-    if (bt_connected) {
-        k_work_schedule(&battery_update_work, K_SECONDS(60));
+    if (atomic_get(&connections)) {
+        pipeline_schedule(&battery_update_work, K_SECONDS(60));
     }
 }
+#else
+// emulated boards have no battery gauge
+static void bas_notify_task(struct k_work *work) {}
+#endif
 
 /*     APP     */
 
-static inline uint8_t pot_val_norm(uint16_t raw_val) {
-    uint8_t value_norm = (uint8_t)((127 * raw_val) / 930);
-    if (value_norm >= 127) value_norm = 127;
-    return value_norm;
-}
-
-static void send_pot_vals(int *idxs, uint16_t *vals, int count) {
-    static uint8_t pot_idx_mapping[6] = {5, 3, 1, 6, 4, 2};
-
-    // Worst case: 1 header + count * (1 ts + 3 MIDI)
-    uint8_t packet[1 + 6 * 4];
-    int offset = 0;
+static const struct device *pots;
+// set when MIDI starts with no central started before
+static atomic_t pots_restart;
 
-    uint16_t timestamp = 0;  // use k_uptime_get if ever needed
+static struct pots_params params;
 
-    // BLE-MIDI header: MSB=1 + high 6 bits of timestamp
-    packet[offset++] = 0x80 | ((timestamp >> 7) & 0x3F);
+static void reset_pots_params(void) {
+    params.minimum_change = 10;
+    params.slow_refresh_period_ms = 400;
+    params.fast_refresh_period_ms = 20;
+    params.fast_refresh_retention_ms = 300;
+    params.latency_goal_ms = 0;
+    params.power_goal = 0;
+}
 
-    for (int i = 0; i < count; i++) {
-        int pot_idx = idxs[i];
+#ifdef CONFIG_POTS_TRIGGER_HW
+static struct k_spinlock frame_lock;
+static uint16_t frame_pot_vals[POTS_AMOUNT];
+static uint32_t frame_timestamp;
+static uint32_t frame_duration_us;
+static bool frame_ready;
+static uint32_t pots_period_ms;
+
+static void pots_frame_ready(const struct device *dev, const struct pots_frame *frame,
+                             void *user_data) {
+    k_spinlock_key_t key = k_spin_lock(&frame_lock);
+    memcpy(frame_pot_vals, frame->samples, sizeof(frame_pot_vals));
+    frame_timestamp = frame->timestamp_ms;
+    frame_duration_us = frame->duration_us;
+    frame_ready = true;
+    k_spin_unlock(&frame_lock, key);
+
+    pipeline_reschedule(&data_out_work, K_NO_WAIT);
+}
+#endif
+
+// Arrange for the next scan in period_ms, by retiming the hardware trigger
+// or by rescheduling the work item
+static void pots_schedule_scan(uint32_t period_ms) {
+#ifdef CONFIG_POTS_TRIGGER_HW
+    pots_period_ms = period_ms;
+    int ret = mixy_pots_start(pots, period_ms * USEC_PER_MSEC, pots_frame_ready, NULL);
+    if (ret < 0) {
+        LOG_ERR("Pots sampling start failed (%d)", ret);
+    }
+#else
+    // just ahead of a connection event with CONFIG_APP_CONN_SYNC
+    pipeline_schedule(&data_out_work, conn_sync_delay(period_ms));
+#endif
+}
 
-        // Timestamp low bits (MSB=1 + low 7 bits)
-        packet[offset++] = 0x80 | (timestamp & 0x7F);
+// timestamp is taken when the conversion finished, for BLE-MIDI timestamps
+static bool pots_get_scan(uint16_t *vals, uint32_t *timestamp) {
+#ifdef CONFIG_POTS_TRIGGER_HW
+    k_spinlock_key_t key = k_spin_lock(&frame_lock);
+    bool ready = frame_ready;
+    memcpy(vals, frame_pot_vals, sizeof(frame_pot_vals));
+    *timestamp = frame_timestamp;
+    if (ready) diag_add(DIAG_ADC_TIME_US, frame_duration_us);
+    frame_ready = false;
+    k_spin_unlock(&frame_lock, key);
+    return ready;
+#else
+    uint32_t start = k_cycle_get_32();
+    int ret = mixy_pots_read(pots, vals);
+    *timestamp = k_uptime_get_32();
+    diag_add(DIAG_ADC_TIME_US, k_cyc_to_us_floor32(k_cycle_get_32() - start));
+    return ret == 0;
+#endif
+}
 
-        // MIDI CC message
-        packet[offset++] = 0xB0;                      // CC on channel 0
-        packet[offset++] = pot_idx_mapping[pot_idx];  // CC number
-        packet[offset++] = pot_val_norm(vals[i]);     // CC value
-    }
+// Book the time since the last call to the refresh mode that was active
+static void pots_account_refresh(bool fast) {
+    static int64_t mode_since;
+    static bool mode_fast;
 
-    int ret = ble_midi_send_packet(packet, offset);
-    if (ret < 0) {
-        LOG_ERR("MIDI packet notify failed (0x%02X)", -ret);
+    int64_t now = k_uptime_get();
+    if (mode_since) {
+        diag_add(mode_fast ? DIAG_FAST_REFRESH_MS : DIAG_SLOW_REFRESH_MS, now - mode_since);
     }
+    mode_since = now;
+    mode_fast = fast;
 }
 
-static void send_all_pot_vals(uint16_t *vals) {
-    int idxs[6] = {0, 1, 2, 3, 4, 5};
-    send_pot_vals(idxs, vals, 6);
+static void pots_sampling_stop(void) {
+#ifdef CONFIG_POTS_TRIGGER_HW
+    mixy_pots_stop(pots);
+#endif
 }
 
-static void send_pot_val(int idx, uint16_t val) {
-    send_pot_vals(&idx, &val, 1);
+// The battery shares the SAADC, which the trigger chain owns while running
+static bool pots_sampling_suspend(void) {
+#ifdef CONFIG_POTS_TRIGGER_HW
+    return mixy_pots_stop(pots) == 0;
+#else
+    return false;
+#endif
 }
 
-#define POTS_AMOUNT 6
+static void pots_sampling_resume(void) {
+#ifdef CONFIG_POTS_TRIGGER_HW
+    pots_schedule_scan(pots_period_ms);
+#endif
+}
 
-static bool sent_initial_vals = false;
-static const struct device *pots;
-static uint16_t prev_pot_vals[POTS_AMOUNT];
-static int64_t last_change_time;
+// The central gets its full state from the next scan, see pots_sync_links()
+static void ble_midi_started(bool first) {
+    if (first) atomic_set(&pots_restart, 1);
 
-static struct pots_params params;
+    if (IS_ENABLED(CONFIG_POTS_TRIGGER_HW)) {
+        pots_schedule_scan(sched_min_period_ms());
+    } else {
+        pipeline_schedule(&data_out_work, K_NO_WAIT);
+    }
+}
 
-static void reset_pots_params(void) {
-    params.minimum_change = 10;
-    params.slow_refresh_period_ms = 400;
-    params.fast_refresh_period_ms = 70;
-    params.fast_refresh_retention_ms = 300;
+static void pots_apply_params(void) {
+    sched_set_params(&params);
+    pots_filter_set_deadband(params.minimum_change << POTS_RAW_SHIFT);
 }
 
-static void ble_midi_started(void) {
-    sent_initial_vals = false;
+static void pots_sync_links(const uint16_t *vals, uint32_t timestamp, bool restart) {
+    int link;
 
-    uint16_t curr_pot_vals[POTS_AMOUNT];
-    mixy_pots_read(pots, curr_pot_vals);
-    memcpy(prev_pot_vals, curr_pot_vals, sizeof(prev_pot_vals));
-    last_change_time = k_uptime_get();
+    // the first central after none starts everything from the current scan
+    if (restart) {
+        midi_out_reset(vals, timestamp);
+        sched_reset();
+    }
 
-    k_work_schedule(&data_out_work, K_NO_WAIT);
+    while ((link = ble_midi_take_sync()) >= 0) {
+        midi_out_sync(link);
+    }
 }
 
-static void pots_send_initial(void) {
-    sent_initial_vals = true;
+static void pots_data_process(uint32_t latency_us) {
+    if (!ble_midi_is_started()) {
+        pots_sampling_stop();
+        return;
+    }
 
-    uint16_t curr_pot_vals[POTS_AMOUNT];
-    mixy_pots_read(pots, curr_pot_vals);
-    send_all_pot_vals(curr_pot_vals);
-    memcpy(prev_pot_vals, curr_pot_vals, sizeof(prev_pot_vals));
-}
+    diag_add(DIAG_WORK_LATENCY_TOTAL_US, latency_us);
+    diag_max(DIAG_WORK_LATENCY_MAX_US, latency_us);
 
-static void pots_data_task(struct k_work *work) {
-    if (!ble_midi_is_started() || !bt_connected) return;
-    
     if (ble_midi_params_changed()) {
         ble_midi_get_params(&params);
+        pots_apply_params();
+        store_save_params(&params);
     }
 
+    calib_update();
+
     uint16_t curr_pot_vals[POTS_AMOUNT];
-    mixy_pots_read(pots, curr_pot_vals);
+    uint32_t timestamp;
+    if (!pots_get_scan(curr_pot_vals, &timestamp)) {
+        pots_schedule_scan(sched_min_period_ms());
+        return;
+    }
+
+    diag_inc(DIAG_SCANS);
+
+    // no MIDI while the pots are swept for calibration
+    if (calib_feed(curr_pot_vals)) {
+        pots_schedule_scan(sched_min_period_ms());
+        return;
+    }
+
+    bool restart = atomic_cas(&pots_restart, 1, 0);
+    if (restart) pots_filter_reset();
+
+    // from here on the scan holds the filtered positions
+    uint8_t changed = pots_filter_feed(curr_pot_vals);
 
-    bool changed = false;
+    pots_sync_links(curr_pot_vals, timestamp, restart);
 
     for (uint8_t i = 0; i < POTS_AMOUNT; i++) {
         if (i == 3) continue;  // ignore pot 3 as it is NC
-        if (abs(curr_pot_vals[i] - prev_pot_vals[i]) > params.minimum_change) {
-            if(sent_initial_vals) send_pot_val(i, curr_pot_vals[i]);
-            prev_pot_vals[i] = curr_pot_vals[i];
-            changed = true;
+        if (!restart && (changed & BIT(i))) {
+            midi_out_set(i, curr_pot_vals[i], timestamp);
         }
     }
 
-    if (changed) {
-        last_change_time = k_uptime_get();
-        if(!sent_initial_vals) pots_send_initial();
-    }
+    // whatever the links have room for, the rest follows as notifications complete
+    midi_out_flush();
 
-    if (k_uptime_get() - last_change_time > params.fast_refresh_retention_ms) {
-        k_work_schedule(&data_out_work, K_MSEC(params.slow_refresh_period_ms));
-    } else {
-        k_work_schedule(&data_out_work, K_MSEC(params.fast_refresh_period_ms));
+    // the next scan follows the fastest pot, see sched_feed()
+    uint32_t period_ms = sched_feed(curr_pot_vals, timestamp);
+    bool active = sched_is_active();
+
+    conn_params_set_active(active);
+    pots_account_refresh(active);
+    pots_schedule_scan(period_ms);
+
+#ifdef CONFIG_POTS_MOTION_WAKE
+    if (!active) {
+        // sleep until a pot moves, then come back at the fastest period
+        mixy_pots_arm_motion(pots, params.minimum_change << POTS_RAW_SHIFT,
+                             sched_min_period_ms() * USEC_PER_MSEC);
     }
+#endif
+}
+
+static void pots_data_task(struct k_work *work) {
+    uint32_t latency_us = pipeline_begin(work);
+    uint32_t cpu_start = cpu_stamp();
+
+    pots_data_process(latency_us);
+    diag_add(DIAG_SCAN_CPU_US, cpu_elapsed_us(cpu_start));
 }
 
 int main(void) {
     int ret;
 
+    pipeline_work_init(&data_out_work, pots_data_task);
+    pipeline_work_init(&battery_update_work, bas_notify_task);
+    midi_out_init();
+
     pots = DEVICE_DT_GET(DT_NODELABEL(pots));
     if (!device_is_ready(pots)) {
         LOG_ERR("Pots not ready");
@@ -244,13 +423,35 @@ int main(void) {
     }
 
     reset_pots_params();
+    pots_apply_params();
+    calib_init();
 
+#ifdef CONFIG_APP_BENCH
+    // no radio, drive the pipeline as if a central had subscribed
+    atomic_set(&connections, 1);
+    ble_midi_init(ble_midi_started);
+    ble_midi_bench_start();
+    bench_start();
+    ARG_UNUSED(ret);
+#else
     ret = bt_enable(NULL);
     if (ret) {
         LOG_ERR("Bluetooth init failed (err %d)", ret);
         return 0;
     }
+
+    // identity and bonds before advertising, then the stored params
+    if (IS_ENABLED(CONFIG_SETTINGS)) {
+        settings_load();
+    }
+    if (store_get_params(&params)) {
+        LOG_INF("Restored pots params");
+        pots_apply_params();
+    }
+    calib_restore();
+
     bt_ready();
+#endif
 
     LOG_INF("Mixy init done");
 
@@ -0,0 +1,202 @@
+#include "midi_out.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/sys/util.h>
+
+#include "ble_midi.h"
+#include "calib.h"
+#include "conn_sync.h"
+#include "diag.h"
+#include "latency.h"
+#include "midi_packet.h"
+#include "pipeline.h"
+
+LOG_MODULE_REGISTER(midi_out, CONFIG_APP_LOG_LEVEL);
+
+// Encoder state of one central, the 14-bit modes only send what changed
+struct out_encoder {
+#ifndef CONFIG_APP_CC_7BIT
+    uint16_t last_sent[POTS_AMOUNT];
+#ifdef CONFIG_APP_CC_NRPN
+    int nrpn_selected;
+#endif
+#endif
+    uint8_t forced;  // pots sent in full with the next packet
+};
+
+struct out_link {
+    struct out_encoder enc;
+    uint8_t dirty;  // pots with a value the central has not been sent
+};
+
+BUILD_ASSERT(POTS_AMOUNT <= 8, "dirty masks hold one bit per pot");
+
+static uint16_t slot_vals[POTS_AMOUNT];
+static uint32_t slot_timestamps[POTS_AMOUNT];
+static struct out_link out_links[CONFIG_BT_MAX_CONN];
+
+static void flush_work_handler(struct k_work *work);
+static struct pipeline_work flush_work;
+
+static void flush_work_handler(struct k_work *work) {
+    pipeline_begin(work);
+    midi_out_flush();
+}
+
+// A link got room again
+static void out_sent(struct bt_conn *conn, void *user_data) {
+#ifdef CONFIG_APP_LATENCY_HIST
+    latency_notify_complete(conn, user_data);
+#endif
+    conn_sync_notify_done(conn);
+    pipeline_reschedule(&flush_work, K_NO_WAIT);
+}
+
+static int packet_add_cc(struct midi_packet *packet, uint32_t timestamp, uint8_t cc,
+                         uint8_t value) {
+    int ret = midi_packet_add_cc(packet, timestamp, 0, cc, value);
+    if (ret == 0) diag_inc(DIAG_MIDI_EVENTS);
+    return ret;
+}
+
+// Adds a pot's events, returns <0 when they do not all fit. The caller
+// rewinds the packet and the encoder then.
+static int packet_add_pot(struct midi_packet *packet, struct out_encoder *enc, int pot) {
+    uint32_t timestamp = slot_timestamps[pot];
+    uint8_t cc = calib_cc(pot);
+    uint16_t value = calib_map(pot, slot_vals[pot]);
+    bool force = enc->forced & BIT(pot);
+    int ret = 0;
+
+#ifdef CONFIG_APP_CC_7BIT
+    ARG_UNUSED(force);
+    ret = packet_add_cc(packet, timestamp, cc, value >> 7);
+#else
+    uint16_t prev = enc->last_sent[pot];
+    uint8_t msb = value >> 7;
+    uint8_t lsb = value & 0x7F;
+
+    bool msb_changed = force || msb != (prev >> 7);
+    // LSB only jitter is not worth a message
+    if (!msb_changed && abs(lsb - (prev & 0x7F)) < CONFIG_APP_HIRES_LSB_THRESHOLD) return 0;
+
+#ifdef CONFIG_APP_CC_NRPN
+    if (force || enc->nrpn_selected != cc) {
+        ret = packet_add_cc(packet, timestamp, MIDI_CC_NRPN_MSB, 0);
+        if (!ret) ret = packet_add_cc(packet, timestamp, MIDI_CC_NRPN_LSB, cc);
+        if (!ret) enc->nrpn_selected = cc;
+    }
+    if (!ret && msb_changed) ret = packet_add_cc(packet, timestamp, MIDI_CC_DATA_ENTRY_MSB, msb);
+    if (!ret) ret = packet_add_cc(packet, timestamp, MIDI_CC_DATA_ENTRY_LSB, lsb);
+#else
+    if (msb_changed) ret = packet_add_cc(packet, timestamp, cc, msb);
+    if (!ret) ret = packet_add_cc(packet, timestamp, cc + MIDI_CC_LSB_OFFSET, lsb);
+#endif
+
+    if (!ret) enc->last_sent[pot] = value;
+#endif
+
+    if (!ret) enc->forced &= ~BIT(pot);
+    return ret;
+}
+
+// Packs as many pending pots as fit into one packet and sends it. Returns
+// false when the link cannot take more right now.
+static bool link_flush_one(int link) {
+    struct out_link *out = &out_links[link];
+    struct midi_packet packet;
+    // only committed once the packet is queued
+    struct out_encoder enc = out->enc;
+    uint8_t sent = 0;
+    uint32_t oldest = UINT32_MAX;
+
+    midi_packet_init(&packet, ble_midi_link_max_payload(link));
+
+    for (int pot = 0; pot < POTS_AMOUNT; pot++) {
+        if (!(out->dirty & BIT(pot))) continue;
+
+        struct midi_packet_mark mark = midi_packet_mark(&packet);
+        struct out_encoder before = enc;
+
+        if (packet_add_pot(&packet, &enc, pot) < 0) {
+            // the rest waits for the next packet
+            midi_packet_rewind(&packet, &mark);
+            enc = before;
+            break;
+        }
+
+        sent |= BIT(pot);
+        oldest = MIN(oldest, slot_timestamps[pot]);
+    }
+
+    if (midi_packet_is_empty(&packet)) {
+        // nothing worth sending, e.g. LSB jitter only
+        out->enc = enc;
+        out->dirty &= ~sent;
+        return false;
+    }
+
+    void *latency_token = latency_enqueue(oldest);
+    int ret = ble_midi_link_send(link, packet.data, packet.len, out_sent, latency_token);
+    if (ret < 0) {
+        latency_cancel(latency_token);
+        if (ret != -EBUSY) {
+            // out of buffers with nothing in flight, no completion will come
+            LOG_DBG("MIDI notify on link %d failed (%d)", link, ret);
+            pipeline_schedule(&flush_work, K_MSEC(CONFIG_APP_MIDI_RETRY_MS));
+        }
+        return false;
+    }
+
+    diag_add(DIAG_MIDI_BYTES, packet.len);
+    out->enc = enc;
+    out->dirty &= ~sent;
+    return out->dirty != 0;
+}
+
+void midi_out_init(void) {
+    pipeline_work_init(&flush_work, flush_work_handler);
+}
+
+void midi_out_set(int pot, uint16_t raw, uint32_t timestamp) {
+    slot_vals[pot] = raw;
+    slot_timestamps[pot] = timestamp;
+
+    for (int link = 0; link < ARRAY_SIZE(out_links); link++) {
+        out_links[link].dirty |= BIT(pot);
+    }
+}
+
+void midi_out_reset(const uint16_t *vals, uint32_t timestamp) {
+    memcpy(slot_vals, vals, sizeof(slot_vals));
+    for (int pot = 0; pot < POTS_AMOUNT; pot++) {
+        slot_timestamps[pot] = timestamp;
+    }
+    for (int link = 0; link < ARRAY_SIZE(out_links); link++) {
+        out_links[link].dirty = 0;
+    }
+}
+
+void midi_out_sync(int link) {
+    struct out_link *out = &out_links[link];
+
+    *out = (struct out_link){0};
+#ifdef CONFIG_APP_CC_NRPN
+    out->enc.nrpn_selected = -1;
+#endif
+    out->enc.forced = BIT_MASK(POTS_AMOUNT);
+    out->dirty = BIT_MASK(POTS_AMOUNT);
+}
+
+void midi_out_flush(void) {
+    for (int link = 0; link < ARRAY_SIZE(out_links); link++) {
+        if (!ble_midi_link_ready(link)) continue;
+
+        while (out_links[link].dirty && link_flush_one(link)) {
+        }
+    }
+}
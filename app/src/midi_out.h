@@ -0,0 +1,25 @@
+#pragma once
+
+#include <stdint.h>
+
+/*
+ * Latest value wins: every pot has one slot, and each central a set of pots
+ * it has not been sent yet. Packets are built when a link has room, so a
+ * congested central gets fewer, fresher updates and always ends up at the
+ * current positions. Call from the pots workqueue only.
+ */
+
+/* Before the first scan or link */
+void midi_out_init(void);
+
+/* Start over from a scan, nothing is pending afterwards */
+void midi_out_reset(const uint16_t *vals, uint32_t timestamp);
+
+/* New value for a pot, replaces one not sent yet */
+void midi_out_set(int pot, uint16_t raw, uint32_t timestamp);
+
+/* Send every pot in full to the link's central, it just started MIDI */
+void midi_out_sync(int link);
+
+/* Send as much as the links have room for */
+void midi_out_flush(void);
@@ -0,0 +1,66 @@
+#include "midi_packet.h"
+
+#include <errno.h>
+#include <zephyr/sys/util.h>
+
+#define MIDI_TS_MASK 0x1FFF
+#define MIDI_TS_HIGH(ts) (((ts) >> 7) & 0x3F)
+#define MIDI_TS_LOW(ts) ((ts) & 0x7F)
+
+// A receiver bumps the header's high bits by one whenever the low 7 bits go
+// backwards, so a later event is only encodable if it is at most one low-byte
+// wrap ahead of the previous one. This also covers the 8192 ms rollover.
+static bool timestamp_encodable(uint16_t prev, uint16_t ts) {
+    if (MIDI_TS_LOW(ts) >= MIDI_TS_LOW(prev)) {
+        return MIDI_TS_HIGH(ts) == MIDI_TS_HIGH(prev);
+    }
+    return MIDI_TS_HIGH(ts) == ((MIDI_TS_HIGH(prev) + 1) & 0x3F);
+}
+
+void midi_packet_init(struct midi_packet *pkt, size_t max_len) {
+    pkt->len = 0;
+    pkt->last_status = 0;
+    pkt->max_len = MIN(max_len, sizeof(pkt->data));
+}
+
+int midi_packet_add_cc(struct midi_packet *pkt, uint16_t timestamp, uint8_t channel,
+                       uint8_t controller, uint8_t value) {
+    timestamp &= MIDI_TS_MASK;
+
+    if (pkt->len != 0 && !timestamp_encodable(pkt->last_timestamp, timestamp)) {
+        return -ERANGE;
+    }
+
+    uint8_t status = 0xB0 | (channel & 0x0F);
+    bool first = pkt->len == 0;
+    // running status never crosses packets, a receiver may have lost the last one
+    bool running = IS_ENABLED(CONFIG_APP_MIDI_RUNNING_STATUS) && !first &&
+                   status == pkt->last_status;
+    // a timestamp byte is needed before every status byte
+    bool with_timestamp = !running || timestamp != pkt->last_timestamp;
+
+    size_t needed = (first ? 1 : 0) + (with_timestamp ? 1 : 0) + (running ? 0 : 1) + 2;
+    if (pkt->len + needed > pkt->max_len) {
+        return -ENOMEM;
+    }
+
+    if (first) {
+        // BLE-MIDI header: MSB=1 + high 6 bits of timestamp
+        pkt->data[pkt->len++] = 0x80 | MIDI_TS_HIGH(timestamp);
+    }
+
+    if (with_timestamp) {
+        // Timestamp low bits (MSB=1 + low 7 bits)
+        pkt->data[pkt->len++] = 0x80 | MIDI_TS_LOW(timestamp);
+        pkt->last_timestamp = timestamp;
+    }
+
+    if (!running) {
+        pkt->data[pkt->len++] = status;
+        pkt->last_status = status;
+    }
+    pkt->data[pkt->len++] = controller & 0x7F;
+    pkt->data[pkt->len++] = value & 0x7F;
+
+    return 0;
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// ATT notification payload is the MTU minus opcode and handle
+#define MIDI_PACKET_MAX_LEN (CONFIG_BT_L2CAP_TX_MTU - 3)
+
+#define MIDI_CC_DATA_ENTRY_MSB 6
+#define MIDI_CC_DATA_ENTRY_LSB 38
+#define MIDI_CC_NRPN_LSB 98
+#define MIDI_CC_NRPN_MSB 99
+// CC n + 32 carries the LSB of 14-bit controller n (n < 32)
+#define MIDI_CC_LSB_OFFSET 32
+
+// Whether a pot can send on controller cc, 14-bit pairs need cc + 32 free for the LSB
+static inline bool midi_cc_assignable(uint8_t cc) {
+#ifdef CONFIG_APP_CC_14BIT
+    return cc < MIDI_CC_LSB_OFFSET;
+#else
+    return cc <= 127;
+#endif
+}
+
+struct midi_packet {
+    uint8_t data[MIDI_PACKET_MAX_LEN];
+    size_t len;
+    size_t max_len;
+    uint16_t last_timestamp;
+    uint8_t last_status;  // 0 when the next event needs its status byte
+};
+
+/* Encoder state to go back to when later events do not fit after all */
+struct midi_packet_mark {
+    size_t len;
+    uint16_t last_timestamp;
+    uint8_t last_status;
+};
+
+void midi_packet_init(struct midi_packet *pkt, size_t max_len);
+
+/*
+ * timestamp is in milliseconds, only its low 13 bits are sent.
+ * With CONFIG_APP_MIDI_RUNNING_STATUS a repeated status byte is left out, and
+ * so is the timestamp of an event sharing it with the one before.
+ * Returns -ENOMEM when the event does not fit and -ERANGE when its timestamp
+ * cannot be expressed relative to the header, the packet is left untouched.
+ */
+int midi_packet_add_cc(struct midi_packet *pkt, uint16_t timestamp, uint8_t channel,
+                       uint8_t controller, uint8_t value);
+
+static inline struct midi_packet_mark midi_packet_mark(const struct midi_packet *pkt) {
+    return (struct midi_packet_mark){pkt->len, pkt->last_timestamp, pkt->last_status};
+}
+
+static inline void midi_packet_rewind(struct midi_packet *pkt, const struct midi_packet_mark *mark) {
+    pkt->len = mark->len;
+    pkt->last_timestamp = mark->last_timestamp;
+    pkt->last_status = mark->last_status;
+}
+
+static inline bool midi_packet_is_empty(const struct midi_packet *pkt) {
+    return pkt->len == 0;
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <zephyr/bluetooth/uuid.h>
+
+// Base for the vendor specific services, n picks the service or characteristic
+#define BT_UUID_MIXY_VAL(n) BT_UUID_128_ENCODE(0x4D495859, (n), 0x4F6E, 0xA1B2, 0x6D6978790000)
+
+#define BT_UUID_MIXY_CONN_PARAMS_SVC_VAL BT_UUID_MIXY_VAL(0x0100)
+#define BT_UUID_MIXY_CONN_PARAMS_CHAR_VAL BT_UUID_MIXY_VAL(0x0101)
+
+#define BT_UUID_MIXY_CONN_PARAMS_SVC BT_UUID_DECLARE_128(BT_UUID_MIXY_CONN_PARAMS_SVC_VAL)
+#define BT_UUID_MIXY_CONN_PARAMS_CHAR BT_UUID_DECLARE_128(BT_UUID_MIXY_CONN_PARAMS_CHAR_VAL)
+
+#define BT_UUID_MIXY_DIAG_SVC_VAL BT_UUID_MIXY_VAL(0x0200)
+#define BT_UUID_MIXY_DIAG_COUNTERS_CHAR_VAL BT_UUID_MIXY_VAL(0x0201)
+#define BT_UUID_MIXY_DIAG_LATENCY_CHAR_VAL BT_UUID_MIXY_VAL(0x0202)
+
+#define BT_UUID_MIXY_DIAG_SVC BT_UUID_DECLARE_128(BT_UUID_MIXY_DIAG_SVC_VAL)
+#define BT_UUID_MIXY_DIAG_COUNTERS_CHAR BT_UUID_DECLARE_128(BT_UUID_MIXY_DIAG_COUNTERS_CHAR_VAL)
+#define BT_UUID_MIXY_DIAG_LATENCY_CHAR BT_UUID_DECLARE_128(BT_UUID_MIXY_DIAG_LATENCY_CHAR_VAL)
+
+#define BT_UUID_MIXY_CALIB_SVC_VAL BT_UUID_MIXY_VAL(0x0300)
+#define BT_UUID_MIXY_CALIB_CHAR_VAL BT_UUID_MIXY_VAL(0x0301)
+
+#define BT_UUID_MIXY_CALIB_SVC BT_UUID_DECLARE_128(BT_UUID_MIXY_CALIB_SVC_VAL)
+#define BT_UUID_MIXY_CALIB_CHAR BT_UUID_DECLARE_128(BT_UUID_MIXY_CALIB_CHAR_VAL)
+
+#define BT_UUID_MIXY_NOISE_SVC_VAL BT_UUID_MIXY_VAL(0x0400)
+#define BT_UUID_MIXY_NOISE_CHAR_VAL BT_UUID_MIXY_VAL(0x0401)
+
+#define BT_UUID_MIXY_NOISE_SVC BT_UUID_DECLARE_128(BT_UUID_MIXY_NOISE_SVC_VAL)
+#define BT_UUID_MIXY_NOISE_CHAR BT_UUID_DECLARE_128(BT_UUID_MIXY_NOISE_CHAR_VAL)
@@ -0,0 +1,83 @@
+#include "pipeline.h"
+
+#include <zephyr/init.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/sys/util.h>
+
+#include "diag.h"
+
+LOG_MODULE_REGISTER(pipeline, CONFIG_APP_LOG_LEVEL);
+
+#define PIPELINE_MAX_TRACKED 8
+
+static K_THREAD_STACK_DEFINE(pipeline_stack, CONFIG_APP_PIPELINE_STACK_SIZE);
+static struct k_work_q pipeline_work_q;
+#define PIPELINE_QUEUE (&pipeline_work_q)
+
+// every initialised item, for the queue depth; only grows before scheduling starts
+static struct pipeline_work *tracked[PIPELINE_MAX_TRACKED];
+static size_t tracked_count;
+
+// A delayed item is due when its timeout expires, a submitted one right away
+static void work_set_due(struct pipeline_work *work) {
+    k_ticks_t expires = k_work_delayable_expires_get(&work->dwork);
+
+    work->due_ticks = expires ? expires : k_uptime_ticks();
+}
+
+void pipeline_work_init(struct pipeline_work *work, k_work_handler_t handler) {
+    k_work_init_delayable(&work->dwork, handler);
+
+    if (tracked_count < ARRAY_SIZE(tracked)) {
+        tracked[tracked_count++] = work;
+    } else {
+        LOG_WRN("More than %d pipeline items, queue depth leaves some out",
+                PIPELINE_MAX_TRACKED);
+    }
+}
+
+int pipeline_schedule(struct pipeline_work *work, k_timeout_t delay) {
+    int ret = k_work_schedule_for_queue(PIPELINE_QUEUE, &work->dwork, delay);
+    // an item already waiting keeps its due time
+    if (ret == 1) work_set_due(work);
+    return ret;
+}
+
+int pipeline_reschedule(struct pipeline_work *work, k_timeout_t delay) {
+    int ret = k_work_reschedule_for_queue(PIPELINE_QUEUE, &work->dwork, delay);
+    if (ret >= 0) work_set_due(work);
+    return ret;
+}
+
+uint32_t pipeline_begin(struct k_work *work) {
+    struct k_work_delayable *dwork = k_work_delayable_from_work(work);
+    struct pipeline_work *item = CONTAINER_OF(dwork, struct pipeline_work, dwork);
+    int64_t now = k_uptime_ticks();
+    uint32_t depth = 1;
+
+    // the other items that are due and waiting behind this one
+    for (size_t i = 0; i < tracked_count; i++) {
+        if (tracked[i] != item &&
+            (k_work_delayable_busy_get(&tracked[i]->dwork) & K_WORK_QUEUED)) {
+            depth++;
+        }
+    }
+
+    uint32_t late_us = k_ticks_to_us_floor32(MAX(now - item->due_ticks, 0));
+
+    diag_max(DIAG_QUEUE_DEPTH_MAX, depth);
+    diag_max(DIAG_QUEUE_LATE_MAX_US, late_us);
+
+    return late_us;
+}
+
+static int pipeline_init(void) {
+    struct k_work_queue_config cfg = {.name = "pipeline"};
+
+    k_work_queue_start(&pipeline_work_q, pipeline_stack, K_THREAD_STACK_SIZEOF(pipeline_stack),
+                       CONFIG_APP_PIPELINE_PRIORITY, &cfg);
+    return 0;
+}
+
+SYS_INIT(pipeline_init, APPLICATION, CONFIG_APPLICATION_INIT_PRIORITY);
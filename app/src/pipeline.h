@@ -0,0 +1,27 @@
+#pragma once
+
+#include <stdint.h>
+#include <zephyr/kernel.h>
+
+/*
+ * The pots pipeline (scans, MIDI output, battery) runs its work items on a
+ * workqueue thread of its own. Items keep their due time so queue depth and
+ * lateness can be counted when they run.
+ */
+struct pipeline_work {
+    struct k_work_delayable dwork;
+    int64_t due_ticks;
+};
+
+/*
+ * k_work_init_delayable() for a pipeline item, before any item is scheduled.
+ * Also counts it into the queue depth, with a warning once that table is full.
+ */
+void pipeline_work_init(struct pipeline_work *work, k_work_handler_t handler);
+
+/* k_work_schedule() and k_work_reschedule() on the pipeline queue */
+int pipeline_schedule(struct pipeline_work *work, k_timeout_t delay);
+int pipeline_reschedule(struct pipeline_work *work, k_timeout_t delay);
+
+/* Call first in the handler, returns how late the item runs in us */
+uint32_t pipeline_begin(struct k_work *work);
@@ -0,0 +1,267 @@
+#include "pots_filter.h"
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <zephyr/bluetooth/bluetooth.h>
+#include <zephyr/bluetooth/gatt.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/sys/byteorder.h>
+#include <zephyr/sys/util.h>
+
+#include "calib.h"
+#include "mixy_uuid.h"
+
+LOG_MODULE_REGISTER(pots_filter, CONFIG_APP_LOG_LEVEL);
+
+#define FILTER_MEDIAN_LEN 3
+// fraction bits of the IIR state
+#define FILTER_IIR_FRAC 4
+
+// Raw units per code of the MIDI output, finer moves cannot be sent anyway
+#ifdef CONFIG_APP_CC_7BIT
+#define FILTER_OUT_STEP MAX(POTS_RAW_MAX >> 7, 1)
+#else
+#define FILTER_OUT_STEP 1
+#endif
+
+// the noise variance follows about the last 2^N quiet scans
+#define NOISE_AVG_SHIFT 6
+// quiet scans before the estimate replaces the configured deadband
+#define NOISE_MIN_SAMPLES 16
+#define NOISE_FAULT_LIMIT (CONFIG_APP_NOISE_FAULT_LIMIT << POTS_RAW_SHIFT)
+
+// pot 3 is not connected, its noise means nothing
+#define NOISE_IGNORED_POTS BIT(3)
+
+BUILD_ASSERT(POTS_AMOUNT <= 8, "change masks hold one bit per pot");
+
+// one array per stage over all pots
+static struct {
+    uint16_t history[FILTER_MEDIAN_LEN][POTS_AMOUNT];
+    int32_t smoothed[POTS_AMOUNT];
+    uint16_t out[POTS_AMOUNT];
+    int8_t direction[POTS_AMOUNT];
+    uint8_t history_pos;
+    uint8_t history_len;
+} state;
+
+// per pot noise estimate, survives filter resets
+static struct {
+    float variance[POTS_AMOUNT];
+    uint16_t deadband[POTS_AMOUNT];
+    uint8_t samples[POTS_AMOUNT];
+    uint8_t faults;
+} noise;
+
+// guards noise against GATT reads
+static struct k_spinlock noise_lock;
+
+static uint16_t deadband = 1;
+
+static void noise_notify(void);
+
+void pots_filter_set_deadband(uint16_t new_deadband) {
+    deadband = MAX(new_deadband, 1);
+
+    k_spinlock_key_t key = k_spin_lock(&noise_lock);
+    for (int i = 0; i < POTS_AMOUNT; i++) {
+        if (!IS_ENABLED(CONFIG_APP_NOISE_AUTO) || noise.samples[i] < NOISE_MIN_SAMPLES) {
+            noise.deadband[i] = deadband;
+        }
+    }
+    k_spin_unlock(&noise_lock, key);
+}
+
+void pots_filter_reset(void) {
+    state.history_pos = 0;
+    state.history_len = 0;
+}
+
+static uint16_t median3(uint16_t a, uint16_t b, uint16_t c) {
+    return MAX(MIN(a, b), MIN(MAX(a, b), c));
+}
+
+static void filter_median(uint16_t *vals) {
+    memcpy(state.history[state.history_pos], vals, sizeof(state.history[0]));
+    state.history_pos = (state.history_pos + 1) % FILTER_MEDIAN_LEN;
+    if (state.history_len < FILTER_MEDIAN_LEN) state.history_len++;
+
+    // a single spike is dropped, a step shows up one scan later
+    if (!IS_ENABLED(CONFIG_APP_FILTER_MEDIAN) || state.history_len < FILTER_MEDIAN_LEN) return;
+
+    for (int i = 0; i < POTS_AMOUNT; i++) {
+        vals[i] = median3(state.history[0][i], state.history[1][i], state.history[2][i]);
+    }
+}
+
+// Smooths jitter, anything moving by more than the deadband per scan is
+// passed through as it is so fast moves get no lag. Returns the pots that
+// moved that fast.
+static uint8_t filter_iir(uint16_t *vals) {
+    uint8_t moving = 0;
+
+    for (int i = 0; i < POTS_AMOUNT; i++) {
+        int32_t in = (int32_t)vals[i] << FILTER_IIR_FRAC;
+        int32_t diff = in - state.smoothed[i];
+
+        if (abs(diff) > ((int32_t)noise.deadband[i] << FILTER_IIR_FRAC)) {
+            state.smoothed[i] = in;
+            moving |= BIT(i);
+        } else {
+            state.smoothed[i] += diff >> CONFIG_APP_FILTER_IIR_SHIFT;
+        }
+        vals[i] = (state.smoothed[i] + BIT(FILTER_IIR_FRAC - 1)) >> FILTER_IIR_FRAC;
+    }
+
+    return moving;
+}
+
+// Moving on in the same direction only needs one output step, turning
+// around needs the full deadband, so jitter around a position is held.
+// Faulty pots hold their output.
+static uint8_t filter_hysteresis(uint16_t *vals) {
+    uint8_t changed = 0;
+
+    for (int i = 0; i < POTS_AMOUNT; i++) {
+        int delta = vals[i] - state.out[i];
+        int8_t direction = delta > 0 ? 1 : -1;
+        uint16_t reverse = MAX(noise.deadband[i], FILTER_OUT_STEP);
+        uint16_t threshold = direction == state.direction[i] ? FILTER_OUT_STEP : reverse;
+
+        if (!(noise.faults & BIT(i)) && delta != 0 && abs(delta) >= threshold) {
+            state.out[i] = vals[i];
+            state.direction[i] = direction;
+            changed |= BIT(i);
+        }
+        vals[i] = state.out[i];
+    }
+
+    return changed;
+}
+
+/*
+ * The second difference of the raw scans cancels the position and any
+ * steady motion, leaving 6x the noise variance. Scans where a pot moved
+ * faster than its deadband or accelerated well beyond its noise are left
+ * out. Returns true when a fault was raised or cleared.
+ */
+static bool noise_update(uint8_t moving) {
+    const uint16_t *h0 = state.history[state.history_pos];
+    const uint16_t *h1 = state.history[(state.history_pos + 1) % FILTER_MEDIAN_LEN];
+    const uint16_t *h2 = state.history[(state.history_pos + 2) % FILTER_MEDIAN_LEN];
+    uint8_t faults = noise.faults;
+
+    if (state.history_len < FILTER_MEDIAN_LEN) return false;
+
+    k_spinlock_key_t key = k_spin_lock(&noise_lock);
+
+    for (int i = 0; i < POTS_AMOUNT; i++) {
+        if ((moving | NOISE_IGNORED_POTS) & BIT(i)) continue;
+
+        float d2 = (int)h2[i] - 2 * (int)h1[i] + (int)h0[i];
+        float sigma = sqrtf(noise.variance[i]);
+        // lets the estimate grow past the fault limit from any start
+        float gate = MAX(4.0f * sqrtf(6.0f) * sigma, 2.0f * NOISE_FAULT_LIMIT);
+
+        if (fabsf(d2) > gate) continue;
+
+        float sample = d2 * d2 / 6.0f;
+        if (noise.samples[i] < NOISE_MIN_SAMPLES) {
+            // plain average until the exponential one has enough history
+            noise.samples[i]++;
+            noise.variance[i] += (sample - noise.variance[i]) / noise.samples[i];
+        } else {
+            noise.variance[i] += (sample - noise.variance[i]) / BIT(NOISE_AVG_SHIFT);
+        }
+
+        if (noise.samples[i] < NOISE_MIN_SAMPLES) continue;
+
+        sigma = sqrtf(noise.variance[i]);
+        if (IS_ENABLED(CONFIG_APP_NOISE_AUTO)) {
+            float band = ceilf(CONFIG_APP_NOISE_DEADBAND_SIGMAS * sigma);
+            noise.deadband[i] = CLAMP(band, 1.0f, UINT16_MAX);
+        }
+
+        // a pot this noisy is drifting or has a bad wiper, with hysteresis
+        if (sigma > NOISE_FAULT_LIMIT) {
+            noise.faults |= BIT(i);
+        } else if (sigma < NOISE_FAULT_LIMIT / 2) {
+            noise.faults &= ~BIT(i);
+        }
+    }
+
+    bool faults_changed = faults != noise.faults;
+    faults = noise.faults;
+    k_spin_unlock(&noise_lock, key);
+
+    if (faults_changed) LOG_WRN("Faulty pots 0x%02x", faults);
+    return faults_changed;
+}
+
+uint8_t pots_filter_feed(uint16_t *vals) {
+    bool first = state.history_len == 0;
+
+    filter_median(vals);
+
+    if (first) {
+        // start from the scan as it is, nothing to report
+        for (int i = 0; i < POTS_AMOUNT; i++) {
+            state.smoothed[i] = (int32_t)vals[i] << FILTER_IIR_FRAC;
+            state.out[i] = vals[i];
+            state.direction[i] = 0;
+        }
+        return 0;
+    }
+
+    uint8_t moving = filter_iir(vals);
+    if (noise_update(moving)) noise_notify();
+
+    return filter_hysteresis(vals);
+}
+
+/*     GATT     */
+
+#define NOISE_POT_LEN 5
+
+// Fault mask, then noise (1/16 raw units) and deadband (raw units) as LE16 for every pot
+static void encode_noise(uint8_t *value) {
+    k_spinlock_key_t key = k_spin_lock(&noise_lock);
+
+    value[0] = noise.faults;
+    for (int i = 0; i < POTS_AMOUNT; i++) {
+        uint8_t *p = &value[1 + i * NOISE_POT_LEN];
+        float sigma = sqrtf(noise.variance[i]) * 16.0f;
+
+        sys_put_le16(MIN(sigma, UINT16_MAX), &p[0]);
+        sys_put_le16(noise.deadband[i], &p[2]);
+        p[4] = noise.samples[i] >= NOISE_MIN_SAMPLES;
+    }
+
+    k_spin_unlock(&noise_lock, key);
+}
+
+static ssize_t read_noise(struct bt_conn *conn, const struct bt_gatt_attr *attr, void *buf,
+                          uint16_t len, uint16_t offset) {
+    uint8_t value[1 + POTS_AMOUNT * NOISE_POT_LEN];
+
+    encode_noise(value);
+    return bt_gatt_attr_read(conn, attr, buf, len, offset, value, sizeof(value));
+}
+
+BT_GATT_SERVICE_DEFINE(noise_svc,
+                       BT_GATT_PRIMARY_SERVICE(BT_UUID_MIXY_NOISE_SVC),
+                       BT_GATT_CHARACTERISTIC(BT_UUID_MIXY_NOISE_CHAR, BT_GATT_CHRC_READ | BT_GATT_CHRC_NOTIFY,
+                                              BT_GATT_PERM_READ, read_noise, NULL, NULL),
+                       BT_GATT_CCC(NULL, BT_GATT_PERM_READ | BT_GATT_PERM_WRITE), );
+
+static void noise_notify(void) {
+    uint8_t value[1 + POTS_AMOUNT * NOISE_POT_LEN];
+
+    encode_noise(value);
+
+    // fails harmlessly when nobody subscribed
+    bt_gatt_notify(NULL, &noise_svc.attrs[1], value, sizeof(value));
+}
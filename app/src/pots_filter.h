@@ -0,0 +1,22 @@
+#pragma once
+
+#include <stdint.h>
+
+/*
+ * Noise filter between the scans and change detection: an optional median
+ * of three, a smoothing IIR that lets moves larger than the deadband through
+ * and a Schmitt style hysteresis on the output. Call from the pots workqueue
+ * only.
+ */
+
+/* Deadband in raw units, a reversal must exceed it to be reported */
+void pots_filter_set_deadband(uint16_t deadband);
+
+/* Forget the history, the next scan is taken as it is */
+void pots_filter_reset(void);
+
+/*
+ * Filter a scan in place, vals then holds the output of every pot.
+ * Returns a mask of the pots whose output changed.
+ */
+uint8_t pots_filter_feed(uint16_t *vals);
@@ -0,0 +1,141 @@
+#include "sched.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/sys/util.h>
+
+#include "calib.h"
+#include "conn_params.h"
+
+// pot 3 is not connected
+#define SCHED_IGNORED_POTS BIT(3)
+
+static struct pots_params params;
+
+static uint16_t prev_vals[POTS_AMOUNT];
+static uint32_t prev_timestamp;
+static bool have_prev;
+
+// per pot speed estimate in raw units per ms, rises with every faster scan
+// and decays with fast_refresh_retention_ms as its time constant
+static float velocity[POTS_AMOUNT];
+static uint32_t period_ms;
+// all pots still since the period reached its maximum
+static bool resting;
+
+void sched_set_params(const struct pots_params *new_params) {
+    params = *new_params;
+}
+
+void sched_reset(void) {
+    have_prev = false;
+    resting = false;
+    period_ms = 0;
+    for (int i = 0; i < POTS_AMOUNT; i++) {
+        velocity[i] = 0.0f;
+    }
+}
+
+// Notifications cannot leave faster than one per connection event
+static uint32_t conn_interval_ms(void) {
+    struct conn_params_info info;
+
+    conn_params_get(&info);
+    return info.interval * 5 / 4;
+}
+
+uint32_t sched_min_period_ms(void) {
+    return MAX(params.fast_refresh_period_ms, conn_interval_ms());
+}
+
+// The period at rest: the latency goal minus the delivery part, which the
+// connection interval adds anyway
+static uint32_t max_period_ms(void) {
+    uint32_t max_period = params.slow_refresh_period_ms;
+
+    if (params.latency_goal_ms) {
+        uint32_t interval = conn_interval_ms();
+        max_period = params.latency_goal_ms > interval ? params.latency_goal_ms - interval : 0;
+    }
+
+    return MAX(max_period, sched_min_period_ms());
+}
+
+// How far the fastest pot may travel between scans. The power goal trades
+// resolution of fast moves for fewer scans, up to 5x the minimum change.
+static float target_step(void) {
+    float step = params.minimum_change << POTS_RAW_SHIFT;
+
+    return MAX(step, 1.0f) * (1.0f + MIN(params.power_goal, 100) / 25.0f);
+}
+
+uint32_t sched_feed(const uint16_t *vals, uint32_t timestamp_ms) {
+    uint32_t min_period = sched_min_period_ms();
+    uint32_t max_period = max_period_ms();
+
+    if (!have_prev) {
+        memcpy(prev_vals, vals, sizeof(prev_vals));
+        prev_timestamp = timestamp_ms;
+        have_prev = true;
+        period_ms = min_period;
+        return period_ms;
+    }
+
+    uint32_t dt = MAX(timestamp_ms - prev_timestamp, 1);
+    float decay = params.fast_refresh_retention_ms
+                      ? expf(-(float)dt / params.fast_refresh_retention_ms)
+                      : 0.0f;
+    // scan to scan jitter is no motion
+    int noise = (params.minimum_change << POTS_RAW_SHIFT) / 2;
+    float step = target_step();
+    float fastest = 0.0f;
+
+    for (int i = 0; i < POTS_AMOUNT; i++) {
+        if (SCHED_IGNORED_POTS & BIT(i)) continue;
+
+        int delta = abs(vals[i] - prev_vals[i]);
+        float speed = delta > noise ? (float)delta / dt : 0.0f;
+
+        // follow acceleration right away, back off smoothly
+        velocity[i] = MAX(speed, velocity[i] * decay);
+        fastest = MAX(fastest, velocity[i]);
+    }
+
+    memcpy(prev_vals, vals, sizeof(prev_vals));
+    prev_timestamp = timestamp_ms;
+
+    uint32_t period;
+    bool slow = false;
+
+    bool fast = fastest * max_period > step;
+
+    if (resting && fast) {
+        // the first move after a rest was spread over a long period, its
+        // speed is underestimated, so start at the fastest rate
+        resting = false;
+        period = min_period;
+    } else if (!fast) {
+        // too slow to need more than the rest period
+        for (int i = 0; i < POTS_AMOUNT; i++) {
+            velocity[i] = 0.0f;
+        }
+        slow = true;
+        period = max_period;
+    } else {
+        period = (uint32_t)(step / fastest);
+    }
+
+    // grow by at most half a period per scan, shrink right away
+    period = MIN(period, period_ms + MAX(period_ms / 2, 1));
+    period_ms = CLAMP(period, min_period, max_period);
+
+    if (slow && period_ms >= max_period) resting = true;
+
+    return period_ms;
+}
+
+bool sched_is_active(void) {
+    return have_prev && !resting;
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "ble_midi.h"
+
+/* Take the period bounds and goals from the params */
+void sched_set_params(const struct pots_params *params);
+
+/* Forget all motion, the next scan only sets the reference */
+void sched_reset(void);
+
+/* Feed a scan, returns the time until the next one in ms */
+uint32_t sched_feed(const uint16_t *vals, uint32_t timestamp_ms);
+
+/* true while some pot is still considered moving */
+bool sched_is_active(void);
+
+/* Shortest period the scheduler currently allows, used as the wake period */
+uint32_t sched_min_period_ms(void);
@@ -0,0 +1,147 @@
+#include <errno.h>
+#include <string.h>
+#include <zephyr/init.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/settings/settings.h>
+#include <zephyr/sys/atomic.h>
+
+#include "store.h"
+
+LOG_MODULE_REGISTER(store, CONFIG_APP_LOG_LEVEL);
+
+#define STORE_ROOT "mixy"
+
+// largest stored value
+#define STORE_VALUE_MAX MAX(sizeof(struct pots_params), sizeof(struct calib_record))
+
+enum store_item {
+    STORE_PARAMS,
+    STORE_CALIB,
+    STORE_ITEM_COUNT,
+};
+
+struct store_entry {
+    const char *name;
+    void *value;
+    size_t len;
+};
+
+static struct pots_params stored_params;
+static struct calib_record stored_calib;
+
+static const struct store_entry entries[STORE_ITEM_COUNT] = {
+    [STORE_PARAMS] = {"params", &stored_params, sizeof(stored_params)},
+    [STORE_CALIB] = {"calib", &stored_calib, sizeof(stored_calib)},
+};
+
+// guards the cached values against a concurrent save
+static struct k_spinlock lock;
+static ATOMIC_DEFINE(dirty, STORE_ITEM_COUNT);
+static ATOMIC_DEFINE(loaded, STORE_ITEM_COUNT);
+
+static K_THREAD_STACK_DEFINE(store_stack, CONFIG_APP_STORE_STACK_SIZE);
+static struct k_work_q store_work_q;
+
+static void save_work_handler(struct k_work *work);
+static K_WORK_DELAYABLE_DEFINE(save_work, save_work_handler);
+
+static void save_work_handler(struct k_work *work) {
+    for (int i = 0; i < STORE_ITEM_COUNT; i++) {
+        uint8_t value[STORE_VALUE_MAX];
+        char key[sizeof(STORE_ROOT "/") + 16];
+
+        if (!atomic_test_and_clear_bit(dirty, i)) continue;
+
+        k_spinlock_key_t lock_key = k_spin_lock(&lock);
+        memcpy(value, entries[i].value, entries[i].len);
+        k_spin_unlock(&lock, lock_key);
+
+        snprintk(key, sizeof(key), STORE_ROOT "/%s", entries[i].name);
+
+        int err = settings_save_one(key, value, entries[i].len);
+        if (err) {
+            LOG_ERR("Saving %s failed (err %d)", key, err);
+        } else {
+            LOG_DBG("Saved %s", key);
+        }
+    }
+}
+
+static void store_item_save(enum store_item item, const void *value) {
+    k_spinlock_key_t key = k_spin_lock(&lock);
+    bool changed = memcmp(entries[item].value, value, entries[item].len) != 0;
+    memcpy(entries[item].value, value, entries[item].len);
+    k_spin_unlock(&lock, key);
+
+    // rewriting an identical value would only wear the flash
+    if (!changed && atomic_test_bit(loaded, item)) return;
+
+    atomic_set_bit(loaded, item);
+    atomic_set_bit(dirty, item);
+
+    // schedule, not reschedule: the first change starts the delay and later
+    // ones ride along, so a stream of changes is still written regularly
+    k_work_schedule_for_queue(&store_work_q, &save_work, K_MSEC(CONFIG_APP_STORE_SAVE_DELAY_MS));
+}
+
+static bool store_item_get(enum store_item item, void *value) {
+    if (!atomic_test_bit(loaded, item)) return false;
+
+    k_spinlock_key_t key = k_spin_lock(&lock);
+    memcpy(value, entries[item].value, entries[item].len);
+    k_spin_unlock(&lock, key);
+    return true;
+}
+
+void store_save_params(const struct pots_params *params) {
+    store_item_save(STORE_PARAMS, params);
+}
+
+bool store_get_params(struct pots_params *params) {
+    return store_item_get(STORE_PARAMS, params);
+}
+
+void store_save_calib(const struct calib_record *calib) {
+    store_item_save(STORE_CALIB, calib);
+}
+
+bool store_get_calib(struct calib_record *calib) {
+    return store_item_get(STORE_CALIB, calib);
+}
+
+static int store_settings_set(const char *name, size_t len, settings_read_cb read_cb,
+                              void *cb_arg) {
+    for (int i = 0; i < STORE_ITEM_COUNT; i++) {
+        const char *next;
+
+        if (!settings_name_steq(name, entries[i].name, &next) || next) continue;
+
+        // stored by a firmware with a different layout
+        if (len != entries[i].len) return -EINVAL;
+
+        uint8_t value[STORE_VALUE_MAX];
+        ssize_t ret = read_cb(cb_arg, value, len);
+        if (ret < 0) return ret;
+
+        k_spinlock_key_t key = k_spin_lock(&lock);
+        memcpy(entries[i].value, value, len);
+        k_spin_unlock(&lock, key);
+
+        atomic_set_bit(loaded, i);
+        return 0;
+    }
+
+    return -ENOENT;
+}
+
+SETTINGS_STATIC_HANDLER_DEFINE(mixy_store, STORE_ROOT, NULL, store_settings_set, NULL, NULL);
+
+static int store_init(void) {
+    k_work_queue_start(&store_work_q, store_stack, K_THREAD_STACK_SIZEOF(store_stack),
+                       K_LOWEST_APPLICATION_THREAD_PRIO, NULL);
+    k_thread_name_set(&store_work_q.thread, "store");
+    return 0;
+}
+
+SYS_INIT(store_init, APPLICATION, CONFIG_APPLICATION_INIT_PRIORITY);
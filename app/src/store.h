@@ -0,0 +1,38 @@
+#pragma once
+
+#include <stdbool.h>
+
+#include "ble_midi.h"
+#include "calib.h"
+
+#ifdef CONFIG_APP_STORE
+
+/*
+ * Persist the pots parameters. The write happens on the store's own low
+ * priority workqueue CONFIG_APP_STORE_SAVE_DELAY_MS after the first
+ * unsaved change, so a burst of changes costs a single flash write.
+ */
+void store_save_params(const struct pots_params *params);
+
+/* Fetch the parameters loaded by settings_load(), false if none were stored */
+bool store_get_params(struct pots_params *params);
+
+/* Same as for the parameters, for the pots calibration */
+void store_save_calib(const struct calib_record *calib);
+bool store_get_calib(struct calib_record *calib);
+
+#else
+
+static inline void store_save_params(const struct pots_params *params) {}
+
+static inline bool store_get_params(struct pots_params *params) {
+    return false;
+}
+
+static inline void store_save_calib(const struct calib_record *calib) {}
+
+static inline bool store_get_calib(struct calib_record *calib) {
+    return false;
+}
+
+#endif
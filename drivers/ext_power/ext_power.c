@@ -6,36 +6,176 @@
 #include <zephyr/drivers/gpio.h>
 #include <zephyr/kernel.h>
 #include <zephyr/logging/log.h>
+#include <zephyr/pm/device.h>
+#include <zephyr/pm/device_runtime.h>
 
 LOG_MODULE_REGISTER(ext_power, CONFIG_EXT_POWER_LOG_LEVEL);
 
 struct ext_power_data {
+    struct k_spinlock lock;
     int current_state;
+    int64_t on_since;
+    uint32_t on_time_ms;
+    uint32_t on_count;
+    // hardware gating on behalf of a claimer, see ext_power_gate()
+    struct ext_power_gate gate;
+    bool has_gate;
+    bool gated;
+    uint64_t gated_since_us;
+    uint64_t gated_on_us;
 };
 
 struct ext_power_config {
     struct gpio_dt_spec ctrl_pin;
 };
 
-static int set_state(const struct device *dev, int state) {
+static uint64_t now_us(void) {
+    return k_ticks_to_us_floor64(k_uptime_ticks());
+}
+
+// Whole gate periods since gated_since_us, the partial one is left for later
+static uint32_t gate_frames(const struct ext_power_data *data, uint64_t now) {
+    return (now - data->gated_since_us) / data->gate.period_us;
+}
+
+static void gate_fold(struct ext_power_data *data, uint64_t now) {
+    uint32_t frames = gate_frames(data, now);
+
+    data->on_count += frames;
+    data->gated_on_us += (uint64_t)frames * data->gate.on_us;
+    data->gated_since_us += (uint64_t)frames * data->gate.period_us;
+}
+
+// Called with the lock held, returns 1 when the pin was taken back from the gate
+static int gate_apply(const struct device *dev) {
+    struct ext_power_data *data = dev->data;
+    // the gating claimer's own reference is the only one
+    bool want = data->has_gate && data->current_state && pm_device_runtime_usage(dev) == 1;
+
+    if (want == data->gated) return 0;
+
+    if (want) {
+        data->on_time_ms += k_uptime_get() - data->on_since;
+        data->gated_since_us = now_us();
+    } else {
+        gate_fold(data, now_us());
+        data->on_since = k_uptime_get();
+    }
+
+    data->gated = want;
+    data->gate.set(want, data->gate.user_data);
+    return !want;
+}
+
+// Only from the PM actions, consumers go through ext_power_claim()
+static void set_state(const struct device *dev, int state) {
     const struct ext_power_config *config = dev->config;
     struct ext_power_data *data = dev->data;
 
-    if (state == data->current_state) return 0;
+    if (state == data->current_state) return;
 
     gpio_pin_set(config->ctrl_pin.port, config->ctrl_pin.pin, state != 0);
 
-    k_busy_wait(5);
-
+    k_spinlock_key_t key = k_spin_lock(&data->lock);
+    if (state) {
+        data->on_since = k_uptime_get();
+        data->on_count++;
+    } else {
+        data->on_time_ms += k_uptime_get() - data->on_since;
+    }
     data->current_state = state;
+    k_spin_unlock(&data->lock, key);
+}
 
-    return 0;
+static uint32_t get_on_time(const struct device *dev) {
+    struct ext_power_data *data = dev->data;
+
+    k_spinlock_key_t key = k_spin_lock(&data->lock);
+    uint64_t gated_on_us = data->gated_on_us;
+    uint32_t on_time = data->on_time_ms;
+
+    if (data->gated) {
+        gated_on_us += (uint64_t)gate_frames(data, now_us()) * data->gate.on_us;
+    } else if (data->current_state) {
+        on_time += k_uptime_get() - data->on_since;
+    }
+    k_spin_unlock(&data->lock, key);
+
+    return on_time + gated_on_us / USEC_PER_MSEC;
+}
+
+static uint32_t get_on_count(const struct device *dev) {
+    struct ext_power_data *data = dev->data;
+
+    k_spinlock_key_t key = k_spin_lock(&data->lock);
+    uint32_t on_count = data->on_count;
+
+    if (data->gated) on_count += gate_frames(data, now_us());
+    k_spin_unlock(&data->lock, key);
+
+    return on_count;
+}
+
+static void set_gate(const struct device *dev, const struct ext_power_gate *gate) {
+    struct ext_power_data *data = dev->data;
+
+    k_spinlock_key_t key = k_spin_lock(&data->lock);
+    if (data->gated) gate_fold(data, now_us());
+
+    if (gate) {
+        data->gate = *gate;
+        data->has_gate = true;
+        gate_apply(dev);
+    } else if (data->has_gate) {
+        data->has_gate = false;
+        gate_apply(dev);
+    }
+    k_spin_unlock(&data->lock, key);
+}
+
+static int claims_changed(const struct device *dev) {
+    struct ext_power_data *data = dev->data;
+
+    k_spinlock_key_t key = k_spin_lock(&data->lock);
+    int ret = gate_apply(dev);
+    k_spin_unlock(&data->lock, key);
+
+    return ret;
 }
 
 static DEVICE_API(ext_power, ext_power_api) = {
-    .set_state = &set_state,
+    .get_on_time = &get_on_time,
+    .get_on_count = &get_on_count,
+    .gate = &set_gate,
+    .claims_changed = &claims_changed,
 };
 
+// The rail follows the runtime PM state, devices in its power domain are
+// told when it comes and goes
+static int ext_power_pm_action(const struct device *dev, enum pm_device_action action) {
+    switch (action) {
+    case PM_DEVICE_ACTION_RESUME:
+        set_state(dev, 1);
+#ifdef CONFIG_PM_DEVICE_POWER_DOMAIN
+        pm_device_children_action_run(dev, PM_DEVICE_ACTION_TURN_ON, NULL);
+#endif
+        break;
+    case PM_DEVICE_ACTION_SUSPEND:
+#ifdef CONFIG_PM_DEVICE_POWER_DOMAIN
+        pm_device_children_action_run(dev, PM_DEVICE_ACTION_TURN_OFF, NULL);
+#endif
+        set_state(dev, 0);
+        break;
+    case PM_DEVICE_ACTION_TURN_ON:
+    case PM_DEVICE_ACTION_TURN_OFF:
+        break;
+    default:
+        return -ENOTSUP;
+    }
+
+    return 0;
+}
+
 static int ext_power_init(const struct device *dev) {
     const struct ext_power_config *config = dev->config;
     int ret;
@@ -51,7 +191,9 @@ static int ext_power_init(const struct device *dev) {
         return ret;
     }
 
-    return 0;
+    // off until the first consumer claims it
+    pm_device_init_suspended(dev);
+    return pm_device_runtime_enable(dev);
 }
 
 #define EXT_POWER_DEFINE(inst)                                         \
@@ -61,7 +203,10 @@ static int ext_power_init(const struct device *dev) {
         .ctrl_pin = GPIO_DT_SPEC_INST_GET(inst, control_gpios),        \
     };                                                                 \
                                                                        \
-    DEVICE_DT_INST_DEFINE(inst, ext_power_init, NULL, &data##inst,     \
+    PM_DEVICE_DT_INST_DEFINE(inst, ext_power_pm_action);               \
+                                                                       \
+    DEVICE_DT_INST_DEFINE(inst, ext_power_init,                        \
+                          PM_DEVICE_DT_INST_GET(inst), &data##inst,    \
                           &config##inst, POST_KERNEL,                  \
                           CONFIG_EXT_POWER_INIT_PRIORITY,              \
                           &ext_power_api);
@@ -0,0 +1,321 @@
+#include <app/drivers/mixy_saadc.h>
+#include <errno.h>
+#include <string.h>
+#include <zephyr/drivers/adc.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/sys/util.h>
+
+#ifdef CONFIG_ADC_NRFX_SAADC
+#include <nrfx_saadc.h>
+#endif
+
+LOG_MODULE_REGISTER(mixy_saadc, CONFIG_MIXY_SAADC_LOG_LEVEL);
+
+#define SAADC_CHANNELS 8
+
+struct piggyback {
+    uint32_t interval_ms;
+    int64_t sampled_at;
+    int16_t sample;
+    uint8_t resolution;
+    bool valid;
+};
+
+// the job in flight, async jobs finish from the ADC's completion context
+struct job_state {
+    struct mixy_saadc_job job;
+    uint32_t channels;
+    int64_t started_at;
+    mixy_saadc_sampling_cb_t cb;
+    void *user_data;
+    bool async;
+};
+
+// a semaphore rather than a mutex, async jobs give it back from the ADC interrupt
+static K_SEM_DEFINE(saadc_lock, 1, 1);
+// the peripheral is driven directly by whoever claimed it
+static bool claimed;
+
+static struct adc_channel_cfg channel_cfgs[SAADC_CHANNELS];
+static uint32_t registered;
+// channels whose configuration is currently in the peripheral
+static uint32_t configured;
+
+static struct piggyback piggybacks[SAADC_CHANNELS];
+static uint32_t piggyback_mask;
+
+static bool calibrated;
+static int64_t calibrated_at;
+
+static struct job_state current;
+static int16_t job_samples[CONFIG_MIXY_SAADC_MAX_SAMPLINGS * SAADC_CHANNELS];
+
+// Gives the peripheral back so it can sleep, the nrfx SAADC otherwise
+// stays active after multi channel reads
+static void saadc_release_peripheral(void) {
+#ifdef CONFIG_ADC_NRFX_SAADC
+    nrfx_saadc_abort();
+#endif
+}
+
+// The ADC driver still wraps up an async job after its last callback
+static void release_work_handler(struct k_work *work) {
+    if (k_sem_take(&saadc_lock, K_NO_WAIT) < 0) return;  // the next job releases it
+
+    if (!claimed) saadc_release_peripheral();
+    k_sem_give(&saadc_lock);
+}
+
+static K_WORK_DEFINE(release_work, release_work_handler);
+
+static int channels_prepare(const struct device *adc, uint32_t channels) {
+    uint32_t pending = channels & ~configured;
+
+    for (int ch = 0; pending; ch++, pending >>= 1) {
+        if (!(pending & 1)) continue;
+
+        int ret = adc_channel_setup(adc, &channel_cfgs[ch]);
+        if (ret < 0) {
+            LOG_ERR("Channel %d setup failed (%d)", ch, ret);
+            return ret;
+        }
+        configured |= BIT(ch);
+    }
+
+    return 0;
+}
+
+int mixy_saadc_channel_setup(const struct device *adc, const struct adc_channel_cfg *cfg) {
+    uint8_t ch = cfg->channel_id;
+    int ret = 0;
+
+    if (ch >= SAADC_CHANNELS) return -EINVAL;
+
+    k_sem_take(&saadc_lock, K_FOREVER);
+
+    if (!(registered & BIT(ch)) || memcmp(&channel_cfgs[ch], cfg, sizeof(*cfg)) != 0) {
+        channel_cfgs[ch] = *cfg;
+        registered |= BIT(ch);
+        configured &= ~BIT(ch);
+        // written to the peripheral with the next job after a release
+        if (!claimed) ret = channels_prepare(adc, BIT(ch));
+    }
+
+    k_sem_give(&saadc_lock);
+    return ret;
+}
+
+static uint32_t piggyback_due(int64_t now) {
+    uint32_t due = 0;
+
+    for (int ch = 0; ch < SAADC_CHANNELS; ch++) {
+        const struct piggyback *pb = &piggybacks[ch];
+
+        if ((piggyback_mask & BIT(ch)) &&
+            (!pb->valid || now - pb->sampled_at >= pb->interval_ms)) {
+            due |= BIT(ch);
+        }
+    }
+
+    return due;
+}
+
+static bool calibration_due(int64_t now) {
+    if (!calibrated) return true;
+
+    return CONFIG_MIXY_SAADC_RECALIBRATE_INTERVAL_S &&
+           now - calibrated_at >= CONFIG_MIXY_SAADC_RECALIBRATE_INTERVAL_S * MSEC_PER_SEC;
+}
+
+// Hands one sampling's results to the job buffer and the piggyback slots
+static void sampling_distribute(uint16_t index) {
+    const int16_t *samples = &job_samples[index * popcount(current.channels)];
+    int16_t *out = &current.job.buffer[index * popcount(current.job.channels)];
+
+    // the ADC stores samples in ascending channel order
+    for (int ch = 0; ch < SAADC_CHANNELS; ch++) {
+        if (!(current.channels & BIT(ch))) continue;
+
+        if (current.job.channels & BIT(ch)) {
+            *out++ = *samples;
+        } else if (index == 0) {
+            piggybacks[ch].sample = *samples;
+            piggybacks[ch].resolution = current.job.resolution;
+            piggybacks[ch].sampled_at = current.started_at;
+            piggybacks[ch].valid = true;
+        }
+        samples++;
+    }
+}
+
+static enum adc_action sampling_done(const struct device *dev, const struct adc_sequence *seq,
+                                     uint16_t index) {
+    bool last = index == current.job.samplings - 1;
+
+    sampling_distribute(index);
+
+    if (last && current.async) {
+        mixy_saadc_sampling_cb_t cb = current.cb;
+        void *user_data = current.user_data;
+
+        k_sem_give(&saadc_lock);
+        k_work_submit(&release_work);
+        if (cb) cb(index, true, user_data);
+    } else if (current.cb) {
+        current.cb(index, last, current.user_data);
+    }
+
+    return ADC_ACTION_CONTINUE;
+}
+
+static int job_start(const struct device *adc, const struct mixy_saadc_job *job,
+                     mixy_saadc_sampling_cb_t cb, void *user_data, bool async) {
+    int64_t now = k_uptime_get();
+
+    if (claimed) return -EBUSY;
+
+    // only channels configured for this ADC, conversion settings follow the
+    // job. The ADC driver rejects oversampling with several channels, so an
+    // oversampled job takes no passengers.
+    uint32_t extra = job->oversampling ? 0 : piggyback_due(now) & registered & ~job->channels;
+    uint32_t channels = job->channels | extra;
+
+    int ret = channels_prepare(adc, channels);
+    if (ret < 0) return ret;
+
+    current = (struct job_state){
+        .job = *job,
+        .channels = channels,
+        .started_at = now,
+        .cb = cb,
+        .user_data = user_data,
+        .async = async,
+    };
+    current.job.samplings = MAX(job->samplings, 1);
+
+    // the sequence is read again by the ADC driver while an async job runs
+    static struct adc_sequence_options options;
+    static struct adc_sequence seq;
+
+    options = (struct adc_sequence_options){
+        .interval_us = job->interval_us,
+        .callback = sampling_done,
+        .extra_samplings = current.job.samplings - 1,
+    };
+    seq = (struct adc_sequence){
+        .options = &options,
+        .channels = channels,
+        .buffer = job_samples,
+        .buffer_size = current.job.samplings * popcount(channels) * sizeof(int16_t),
+        .resolution = job->resolution,
+        .oversampling = job->oversampling,
+        .calibrate = calibration_due(now),
+    };
+
+    if (seq.calibrate) {
+        calibrated = true;
+        calibrated_at = now;
+    }
+
+#ifdef CONFIG_ADC_ASYNC
+    if (async) {
+        ret = adc_read_async(adc, &seq, NULL);
+    } else
+#endif
+    {
+        ret = adc_read(adc, &seq);
+        saadc_release_peripheral();
+    }
+
+    // try again with the next job
+    if (ret < 0 && seq.calibrate) calibrated = false;
+
+    return ret;
+}
+
+static bool job_valid(const struct mixy_saadc_job *job) {
+    return !(job->channels & ~registered) && job->samplings <= CONFIG_MIXY_SAADC_MAX_SAMPLINGS;
+}
+
+int mixy_saadc_read(const struct device *adc, const struct mixy_saadc_job *job) {
+    if (!job_valid(job)) return -EINVAL;
+
+    k_sem_take(&saadc_lock, K_FOREVER);
+    int ret = job_start(adc, job, NULL, NULL, false);
+    k_sem_give(&saadc_lock);
+
+    return ret;
+}
+
+#ifdef CONFIG_ADC_ASYNC
+
+int mixy_saadc_read_async(const struct device *adc, const struct mixy_saadc_job *job,
+                          mixy_saadc_sampling_cb_t cb, void *user_data) {
+    if (!job_valid(job)) return -EINVAL;
+
+    k_sem_take(&saadc_lock, K_FOREVER);
+
+    int ret = job_start(adc, job, cb, user_data, true);
+    if (ret < 0) {
+        saadc_release_peripheral();
+        k_sem_give(&saadc_lock);
+    }
+
+    return ret;
+}
+
+#endif /* CONFIG_ADC_ASYNC */
+
+int mixy_saadc_piggyback(uint8_t channel, uint32_t interval_ms) {
+    if (channel >= SAADC_CHANNELS) return -EINVAL;
+
+    k_sem_take(&saadc_lock, K_FOREVER);
+    piggybacks[channel].interval_ms = interval_ms;
+    piggyback_mask |= BIT(channel);
+    k_sem_give(&saadc_lock);
+    return 0;
+}
+
+int mixy_saadc_piggyback_get(uint8_t channel, int16_t *sample, uint8_t *resolution,
+                             uint32_t max_age_ms) {
+    int ret = -EAGAIN;
+
+    if (channel >= SAADC_CHANNELS) return -EINVAL;
+
+    k_sem_take(&saadc_lock, K_FOREVER);
+    const struct piggyback *pb = &piggybacks[channel];
+    if (pb->valid && k_uptime_get() - pb->sampled_at <= max_age_ms) {
+        *sample = pb->sample;
+        *resolution = pb->resolution;
+        ret = 0;
+    }
+    k_sem_give(&saadc_lock);
+
+    return ret;
+}
+
+int mixy_saadc_claim(k_timeout_t timeout) {
+    if (k_sem_take(&saadc_lock, timeout) < 0) return -EBUSY;
+
+    int ret = 0;
+    if (claimed) {
+        ret = -EBUSY;
+    } else {
+        claimed = true;
+    }
+
+    k_sem_give(&saadc_lock);
+    return ret;
+}
+
+void mixy_saadc_release(void) {
+    k_sem_take(&saadc_lock, K_FOREVER);
+
+    // the claimer may have rewritten any channel
+    configured = 0;
+    claimed = false;
+    saadc_release_peripheral();
+
+    k_sem_give(&saadc_lock);
+}
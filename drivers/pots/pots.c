@@ -1,62 +1,708 @@
 #define DT_DRV_COMPAT mixy_pots
 
 #include <app/drivers/ext_power.h>
+#include <app/drivers/mixy_saadc.h>
 #include <app/drivers/pots.h>
-#include <nrfx_saadc.h>
+#include <string.h>
 #include <zephyr/device.h>
 #include <zephyr/devicetree.h>
 #include <zephyr/drivers/adc.h>
 #include <zephyr/drivers/gpio.h>
 #include <zephyr/kernel.h>
 #include <zephyr/logging/log.h>
+#include <zephyr/sys/util.h>
+
+#ifdef CONFIG_POTS_TRIGGER_HW
+#include <helpers/nrfx_gppi.h>
+#include <nrfx_gpiote.h>
+#include <nrfx_saadc.h>
+#include <nrfx_timer.h>
+#include <soc.h>
+#endif
 
 LOG_MODULE_REGISTER(pots, CONFIG_POTS_LOG_LEVEL);
 
+#define POTS_ACQ_TIME_US 40
+#define POTS_CONV_TIME_US 2
+#define POTS_BANK_TIME_US \
+    ((POTS_BANK_SIZE * (POTS_ACQ_TIME_US + POTS_CONV_TIME_US) << CONFIG_POTS_OVERSAMPLING) + 4)
+
+#define POTS_POWER_SETTLE_US DT_PROP(DT_NODELABEL(ext_power), startup_delay_us)
+
+#ifdef CONFIG_POTS_MOTION_WAKE
+// while armed a DMA buffer holds a heartbeat's worth of frames
+#define POTS_TRIGGER_BUF_LEN (CONFIG_POTS_MOTION_HEARTBEAT_FRAMES * POTS_FRAME_LEN)
+#else
+#define POTS_TRIGGER_BUF_LEN POTS_FRAME_LEN
+#endif
+
 struct pots_config {
     struct gpio_dt_spec mux;
     const struct adc_dt_spec *adc_specs;
+    // between the bank A and bank B sampling starts, 0 when the mux settles
+    // within bank B's acquisition time
+    uint32_t bank_interval_us;
+#ifdef CONFIG_POTS_TRIGGER_HW
+    uint32_t mux_psel;
+#endif
+};
+
+/*
+ * Software scans run as a state machine, none of the waits block a thread:
+ *   read_async: rail claimed, settle_timer armed for the rail startup delay
+ *               when that switched it on
+ *   settle_timer -> start_work: one SAADC job of two samplings
+ *   bank A done: mux to bank B, settles during bank B's acquisition
+ *   bank B done: mux back to bank A so it settles while idle, rail
+ *                released through release_work, signal raised
+ */
+struct pots_data {
+    const struct device *dev;
+    struct k_timer settle_timer;
+    struct k_work start_work;
+    // runtime PM cannot be relied on from the SAADC interrupt
+    struct k_work release_work;
+    // one per finished scan, a resubmitted work item would run only once
+    atomic_t releases;
+    // the caller's buffer and signal, dropped when pots_read() gives up
+    struct k_spinlock request_lock;
+    struct k_poll_signal *signal;
+    uint16_t *sample_buf;
+    // for pots_read(), a stack signal could be raised after a timeout
+    struct k_poll_signal read_signal;
+    // the SAADC job writes here, a caller's buffer may be gone by then
+    uint16_t scan_buf[POTS_FRAME_LEN];
+    atomic_t busy;
+#ifdef CONFIG_POTS_TRIGGER_HW
+    pots_frame_cb_t frame_cb;
+    void *user_data;
+    uint16_t frame_bufs[2][POTS_TRIGGER_BUF_LEN];
+    const uint16_t *last_frame;
+    uint8_t next_buf;
+    uint8_t ppi_chs[4];
+    uint8_t gpiote_ch;
+    uint8_t rail_gpiote_ch;
+    bool running;
+#endif
+#ifdef CONFIG_POTS_MOTION_WAKE
+    uint32_t wake_period_us;
+    bool motion_armed;
+    // stopped on motion, the partial buffer is not a frame
+    bool restarting;
+#endif
 };
 
 const struct device *ext_power_dev = DEVICE_DT_GET(DT_NODELABEL(ext_power));
 
-struct adc_sequence seq = {
-    .buffer_size = 3 * sizeof(uint16_t),
-    .resolution = 10,
-    .oversampling = NRF_SAADC_OVERSAMPLE_DISABLED,
+// Scan starts run here rather than on the system workqueue, so a caller
+// blocked in pots_read() on any queue never waits for itself
+static K_THREAD_STACK_DEFINE(pots_work_q_stack, CONFIG_POTS_WORKQ_STACK_SIZE);
+static struct k_work_q pots_work_q;
+
+// SAADC channels of one mux bank
+static uint32_t bank_channels;
+
+#ifdef CONFIG_POTS_TRIGGER_HW
+
+BUILD_ASSERT(DT_NUM_INST_STATUS_OKAY(DT_DRV_COMPAT) <= 1,
+             "Hardware triggered sampling supports a single pots instance");
+
+/*
+ * Frame timing, driven by TIMER3 in 1 MHz mode:
+ *   CC0 -> SAADC SAMPLE, after the rail settled
+ *   CC1 -> GPIOTE toggle mux to bank B
+ *   CC3 -> GPIOTE toggle mux back to bank A, GPIOTE rail off
+ *   CC5 -> end of period, clears the timer, GPIOTE rail on
+ * A single SAMPLE scans six SAADC channels: 0-2 and 3-5 are both set to the
+ * pots' inputs, one set per mux bank. CC1 falls into the last conversion of
+ * channel 2, whose input is held by then, and bank B settles during channel
+ * 3's acquisition. Every pot has a channel of its own, and with it its own
+ * limit window for the motion wake. The frame lands in a DMA double buffer,
+ * so the CPU is woken once per frame, or once per heartbeat while armed.
+ *
+ * The chain claims ext_power while it runs and registers the rail's GPIOTE
+ * channel as its gate. While no one else claims the rail, ext_power hands
+ * the pin over and it is only on from the end of one period to CC3 of the
+ * next frame; any other claim takes it back steadily on.
+ */
+#define POTS_MUX_SETTLE_US DT_INST_PROP(0, mux_settle_us)
+
+#define POTS_RAIL_PSEL NRF_DT_GPIOS_TO_PSEL(DT_NODELABEL(ext_power), control_gpios)
+#define POTS_RAIL_ACTIVE_LOW \
+    ((DT_GPIO_FLAGS(DT_NODELABEL(ext_power), control_gpios) & GPIO_ACTIVE_LOW) != 0)
+
+#if CONFIG_POTS_RESOLUTION == 12
+#define POTS_SAADC_RESOLUTION NRF_SAADC_RESOLUTION_12BIT
+#else
+#define POTS_SAADC_RESOLUTION NRF_SAADC_RESOLUTION_10BIT
+#endif
+
+// one channel of the scan, burst mode repeats acquisition and conversion
+#define POTS_CHANNEL_TIME_US ((POTS_ACQ_TIME_US + POTS_CONV_TIME_US) << CONFIG_POTS_OVERSAMPLING)
+
+#define POTS_CC_SAMPLE (1 + POTS_POWER_SETTLE_US)
+#define POTS_CC_MUX_B (POTS_CC_SAMPLE + POTS_BANK_SIZE * POTS_CHANNEL_TIME_US - POTS_CONV_TIME_US)
+#define POTS_CC_MUX_A (POTS_CC_SAMPLE + POTS_FRAME_LEN * POTS_CHANNEL_TIME_US + 4)
+#define POTS_MIN_PERIOD_US (POTS_CC_MUX_A + 1)
+
+// conversions can finish early, so bank B's first acquisition may start up to
+// the bank's conversion time ahead of CC1 and still has to see the mux settled
+BUILD_ASSERT((POTS_BANK_SIZE * POTS_CONV_TIME_US << CONFIG_POTS_OVERSAMPLING) +
+                     POTS_MUX_SETTLE_US <=
+                 POTS_ACQ_TIME_US,
+             "Mux settle time too long for a single scan, lower POTS_OVERSAMPLING");
+
+static const nrfx_timer_t trigger_timer = NRFX_TIMER_INSTANCE(3);
+static const nrfx_gpiote_t gpiote = NRFX_GPIOTE_INSTANCE(0);
+static const struct device *hw_dev;
+
+static void trigger_set_period(uint32_t period_us);
+
+static void rail_set(bool on) {
+    if (on != POTS_RAIL_ACTIVE_LOW) {
+        nrfx_gpiote_set_task_trigger(&gpiote, POTS_RAIL_PSEL);
+    } else {
+        nrfx_gpiote_clr_task_trigger(&gpiote, POTS_RAIL_PSEL);
+    }
+}
+
+static uint32_t rail_task_address(bool on) {
+    return on != POTS_RAIL_ACTIVE_LOW ? nrfx_gpiote_set_task_address_get(&gpiote, POTS_RAIL_PSEL)
+                                      : nrfx_gpiote_clr_task_address_get(&gpiote, POTS_RAIL_PSEL);
+}
+
+// From ext_power, with the task disabled the pin follows ext_power's output level
+static void rail_gate_set(bool gated, void *user_data) {
+    if (gated) {
+        nrfx_gpiote_out_task_enable(&gpiote, POTS_RAIL_PSEL);
+    } else {
+        nrfx_gpiote_out_task_disable(&gpiote, POTS_RAIL_PSEL);
+    }
+}
+
+static struct ext_power_gate rail_gate = {
+    .set = rail_gate_set,
+    .on_us = POTS_CC_MUX_A,
 };
 
-static int pots_read(const struct device *dev, uint16_t *sample_buf) {
+// Samples per DMA buffer, a heartbeat's worth of frames while armed
+static uint16_t trigger_buf_len(const struct pots_data *data) {
+#ifdef CONFIG_POTS_MOTION_WAKE
+    if (data->motion_armed) return POTS_TRIGGER_BUF_LEN;
+#endif
+    return POTS_FRAME_LEN;
+}
+
+// START is issued by the first buffer_set(), SAMPLE comes from the timer
+static void trigger_buffers_start(struct pots_data *data) {
+    nrfx_saadc_buffer_set((nrf_saadc_value_t *)data->frame_bufs[0], trigger_buf_len(data));
+    nrfx_saadc_buffer_set((nrf_saadc_value_t *)data->frame_bufs[1], trigger_buf_len(data));
+    data->next_buf = 0;
+}
+
+#ifdef CONFIG_POTS_MOTION_WAKE
+
+static void motion_limits_clear(void) {
+    for (int ch = 0; ch < POTS_FRAME_LEN; ch++) {
+        nrfx_saadc_limits_set(ch, INT16_MIN, INT16_MAX);
+    }
+}
+
+/*
+ * Limit event: a pot left its window. The long buffer would hold the next
+ * frames back for the rest of the heartbeat, so the SAADC is stopped and
+ * restarted with single frame buffers once nrfx reports it finished; the
+ * next frame already comes at the wake period.
+ */
+static void motion_trip(struct pots_data *data) {
+    if (!data->motion_armed) return;
+
+    data->motion_armed = false;
+    motion_limits_clear();
+    trigger_set_period(data->wake_period_us);
+
+    data->restarting = true;
+    nrfx_saadc_abort();
+}
+
+#endif /* CONFIG_POTS_MOTION_WAKE */
+
+static void saadc_event_handler(const nrfx_saadc_evt_t *event) {
+    const struct device *dev = hw_dev;
+    struct pots_data *data = dev->data;
+
+    switch (event->type) {
+    case NRFX_SAADC_EVT_BUF_REQ:
+#ifdef CONFIG_POTS_MOTION_WAKE
+        if (data->restarting) break;
+#endif
+        nrfx_saadc_buffer_set((nrf_saadc_value_t *)data->frame_bufs[data->next_buf],
+                              trigger_buf_len(data));
+        data->next_buf ^= 1;
+        break;
+
+    case NRFX_SAADC_EVT_DONE: {
+#ifdef CONFIG_POTS_MOTION_WAKE
+        if (data->restarting) break;
+#endif
+        // the latest frame, a heartbeat buffer holds several
+        struct pots_frame frame = {
+            .samples = (const uint16_t *)event->data.done.p_buffer + event->data.done.size -
+                       POTS_FRAME_LEN,
+            .timestamp_ms = k_uptime_get_32(),
+            .duration_us = nrfx_timer_capture(&trigger_timer, NRF_TIMER_CC_CHANNEL4) -
+                           POTS_CC_SAMPLE,
+        };
+
+        data->last_frame = frame.samples;
+        if (data->frame_cb) data->frame_cb(dev, &frame, data->user_data);
+        break;
+    }
+
+#ifdef CONFIG_POTS_MOTION_WAKE
+    case NRFX_SAADC_EVT_LIMIT:
+        motion_trip(data);
+        break;
+
+    case NRFX_SAADC_EVT_FINISHED:
+        if (data->restarting) {
+            data->restarting = false;
+            trigger_buffers_start(data);
+        }
+        break;
+#endif
+
+    default:
+        break;
+    }
+}
+
+static int trigger_hw_init(const struct device *dev) {
     const struct pots_config *config = dev->config;
-    int ret;
+    struct pots_data *data = dev->data;
+    nrfx_err_t err;
 
-    ext_power_set_state(ext_power_dev, 1);
+    hw_dev = dev;
 
-    for (int xy = 0; xy <= 1; xy++) {
-        ret = gpio_pin_set_dt(&config->mux, xy);
-        if (ret < 0) return ret;
-        k_busy_wait(5);  // allow mux to settle
+    nrfx_timer_config_t timer_cfg = NRFX_TIMER_DEFAULT_CONFIG(NRFX_MHZ_TO_HZ(1));
+    timer_cfg.bit_width = NRF_TIMER_BIT_WIDTH_32;
+    err = nrfx_timer_init(&trigger_timer, &timer_cfg, NULL);
+    if (err != NRFX_SUCCESS) return -EBUSY;
 
-        seq.buffer = &sample_buf[xy * 3];
+    nrfx_timer_compare(&trigger_timer, NRF_TIMER_CC_CHANNEL0, POTS_CC_SAMPLE, false);
+    nrfx_timer_compare(&trigger_timer, NRF_TIMER_CC_CHANNEL1, POTS_CC_MUX_B, false);
+    nrfx_timer_compare(&trigger_timer, NRF_TIMER_CC_CHANNEL3, POTS_CC_MUX_A, false);
 
-        // assume all channels are on the same ADC
-        ret = adc_read_dt(&config->adc_specs[0], &seq);
-        if (ret < 0) return ret;
+    if (!nrfx_gpiote_init_check(&gpiote)) {
+        err = nrfx_gpiote_init(&gpiote, 0);
+        if (err != NRFX_SUCCESS) return -EBUSY;
     }
 
-    // mitigation for a probable nrfx_saadc bug
-    // resulting in periperal/CPU not going to sleep after multi channel read
-    nrfx_saadc_abort();
+    err = nrfx_gpiote_channel_alloc(&gpiote, &data->gpiote_ch);
+    if (err != NRFX_SUCCESS) return -ENOMEM;
+
+    err = nrfx_gpiote_channel_alloc(&gpiote, &data->rail_gpiote_ch);
+    if (err != NRFX_SUCCESS) return -ENOMEM;
+
+    for (int i = 0; i < ARRAY_SIZE(data->ppi_chs); i++) {
+        err = nrfx_gppi_channel_alloc(&data->ppi_chs[i]);
+        if (err != NRFX_SUCCESS) return -ENOMEM;
+    }
+
+    uint32_t sample_task = nrf_saadc_task_address_get(NRF_SAADC, NRF_SAADC_TASK_SAMPLE);
+    uint32_t mux_task = nrfx_gpiote_out_task_address_get(&gpiote, config->mux_psel);
+
+    nrfx_gppi_channel_endpoints_setup(
+        data->ppi_chs[0],
+        nrfx_timer_compare_event_address_get(&trigger_timer, NRF_TIMER_CC_CHANNEL0), sample_task);
+    nrfx_gppi_channel_endpoints_setup(
+        data->ppi_chs[1],
+        nrfx_timer_compare_event_address_get(&trigger_timer, NRF_TIMER_CC_CHANNEL1), mux_task);
+    nrfx_gppi_channel_endpoints_setup(
+        data->ppi_chs[2],
+        nrfx_timer_compare_event_address_get(&trigger_timer, NRF_TIMER_CC_CHANNEL3), mux_task);
+    nrfx_gppi_fork_endpoint_setup(data->ppi_chs[2], rail_task_address(false));
+    nrfx_gppi_channel_endpoints_setup(
+        data->ppi_chs[3],
+        nrfx_timer_compare_event_address_get(&trigger_timer, NRF_TIMER_CC_CHANNEL5),
+        rail_task_address(true));
 
-    ext_power_set_state(ext_power_dev, 0);
     return 0;
 }
 
+static uint32_t trigger_ppi_mask(const struct pots_data *data) {
+    uint32_t mask = 0;
+    for (int i = 0; i < ARRAY_SIZE(data->ppi_chs); i++) {
+        mask |= BIT(data->ppi_chs[i]);
+    }
+    return mask;
+}
+
+static void trigger_set_period(uint32_t period_us) {
+    uint32_t ticks = nrfx_timer_us_to_ticks(&trigger_timer, period_us);
+
+    nrfx_timer_extended_compare(&trigger_timer, NRF_TIMER_CC_CHANNEL5, ticks,
+                                NRF_TIMER_SHORT_COMPARE5_CLEAR_MASK, false);
+
+    // a shorter period may already have been passed, restart the frame instead of
+    // waiting for the counter to wrap; only past CC3 so the mux toggles stay paired
+    if (nrfx_timer_capture(&trigger_timer, NRF_TIMER_CC_CHANNEL4) >= ticks) {
+        // clearing skips CC5, the rail went off at CC3
+        rail_set(true);
+        nrfx_timer_clear(&trigger_timer);
+    }
+
+    rail_gate.period_us = period_us;
+    ext_power_gate(ext_power_dev, &rail_gate);
+}
+
+// Both banks' copies of the pot channels, see the frame timing above
+static int trigger_channels_config(const struct pots_config *config) {
+    nrfx_saadc_channel_t channels[POTS_FRAME_LEN];
+
+    for (int i = 0; i < POTS_FRAME_LEN; i++) {
+        const struct adc_dt_spec *spec = &config->adc_specs[i % POTS_BANK_SIZE];
+
+        channels[i] = (nrfx_saadc_channel_t)NRFX_SAADC_DEFAULT_CHANNEL_SE(
+            NRF_SAADC_INPUT_AIN0 + spec->channel_id, i);
+        channels[i].channel_config.acq_time = NRF_SAADC_ACQTIME_40US;
+    }
+
+    return nrfx_saadc_channels_config(channels, POTS_FRAME_LEN) == NRFX_SUCCESS ? 0 : -EIO;
+}
+
+static int pots_start(const struct device *dev, uint32_t period_us, pots_frame_cb_t cb,
+                      void *user_data) {
+    const struct pots_config *config = dev->config;
+    struct pots_data *data = dev->data;
+    nrfx_err_t err;
+
+    if (period_us < POTS_MIN_PERIOD_US) return -EINVAL;
+
+    unsigned int key = irq_lock();
+    data->frame_cb = cb;
+    data->user_data = user_data;
+    irq_unlock(key);
+
+    if (data->running) {
+        trigger_set_period(period_us);
+        return 0;
+    }
+
+    // a software scan still owns the rail and the mux
+    if (atomic_get(&data->busy)) return -EBUSY;
+
+    // the chain drives the SAADC directly, keep other jobs away until pots_stop()
+    if (mixy_saadc_claim(K_MSEC(CONFIG_POTS_SAADC_CLAIM_TIMEOUT_MS)) < 0) return -EBUSY;
+
+    // other jobs may have used the SAADC since the last pots_start(), e.g.
+    // stop -> battery reading -> start, so the chain sets up its own channels
+    // every time, mixy_saadc_release() makes the driver rewrite its own later
+    int ret = trigger_channels_config(config);
+    if (ret < 0) {
+        LOG_ERR("SAADC channel setup failed (%d)", ret);
+        mixy_saadc_release();
+        return ret;
+    }
+
+    // frames start a full period later, the rail settles well before
+    ret = ext_power_claim(ext_power_dev);
+    if (ret < 0) {
+        mixy_saadc_release();
+        return ret;
+    }
+
+    nrfx_saadc_adv_config_t adv_cfg = NRFX_SAADC_DEFAULT_ADV_CONFIG;
+    adv_cfg.start_on_end = true;
+    adv_cfg.oversampling = (nrf_saadc_oversample_t)CONFIG_POTS_OVERSAMPLING;
+    adv_cfg.burst = CONFIG_POTS_OVERSAMPLING ? NRF_SAADC_BURST_ENABLED : NRF_SAADC_BURST_DISABLED;
+    err = nrfx_saadc_advanced_mode_set(BIT_MASK(POTS_FRAME_LEN), POTS_SAADC_RESOLUTION, &adv_cfg,
+                                       saadc_event_handler);
+    if (err != NRFX_SUCCESS) {
+        LOG_ERR("SAADC advanced mode setup failed (0x%08x)", err);
+        ext_power_release(ext_power_dev);
+        mixy_saadc_release();
+        return -EIO;
+    }
+
+    data->last_frame = NULL;
+    trigger_buffers_start(data);
+
+    nrfx_gpiote_output_config_t out_cfg = NRFX_GPIOTE_DEFAULT_OUTPUT_CONFIG;
+    nrfx_gpiote_task_config_t task_cfg = {
+        .task_ch = data->gpiote_ch,
+        .polarity = NRF_GPIOTE_POLARITY_TOGGLE,
+        .init_val = NRF_GPIOTE_INITIAL_VALUE_LOW,
+    };
+    nrfx_gpiote_output_configure(&gpiote, config->mux_psel, &out_cfg, &task_cfg);
+    nrfx_gpiote_out_task_enable(&gpiote, config->mux_psel);
+
+    // on for the first frame, then switched by the timer once ext_power
+    // enables the task, see rail_gate_set()
+    nrfx_gpiote_task_config_t rail_task_cfg = {
+        .task_ch = data->rail_gpiote_ch,
+        .polarity = NRF_GPIOTE_POLARITY_TOGGLE,
+        .init_val = POTS_RAIL_ACTIVE_LOW ? NRF_GPIOTE_INITIAL_VALUE_LOW
+                                         : NRF_GPIOTE_INITIAL_VALUE_HIGH,
+    };
+    nrfx_gpiote_output_configure(&gpiote, POTS_RAIL_PSEL, &out_cfg, &rail_task_cfg);
+
+    nrfx_gppi_channels_enable(trigger_ppi_mask(data));
+
+    nrfx_timer_clear(&trigger_timer);
+    trigger_set_period(period_us);
+    nrfx_timer_enable(&trigger_timer);
+
+    data->running = true;
+    return 0;
+}
+
+#ifdef CONFIG_POTS_MOTION_WAKE
+
+/*
+ * Arm SAADC limit events around the latest frame, every pot on a channel of
+ * its own. Buffers requested from now on hold a heartbeat's worth of frames,
+ * so the DONE interrupt only comes once per heartbeat until a limit trips.
+ */
+static int pots_arm_motion(const struct device *dev, uint16_t deadband, uint32_t wake_period_us) {
+    struct pots_data *data = dev->data;
+
+    if (!data->running || data->last_frame == NULL) return -EAGAIN;
+    if (wake_period_us < POTS_MIN_PERIOD_US) return -EINVAL;
+
+    unsigned int key = irq_lock();
+
+    const uint16_t *frame = data->last_frame;
+
+    for (int ch = 0; ch < POTS_FRAME_LEN; ch++) {
+        int low = frame[ch] - deadband;
+        int high = frame[ch] + deadband;
+        nrfx_saadc_limits_set(ch, CLAMP(low, INT16_MIN, INT16_MAX), CLAMP(high, INT16_MIN, INT16_MAX));
+    }
+
+    data->wake_period_us = wake_period_us;
+    data->motion_armed = true;
+
+    irq_unlock(key);
+    return 0;
+}
+
+#endif /* CONFIG_POTS_MOTION_WAKE */
+
+static int pots_stop(const struct device *dev) {
+    const struct pots_config *config = dev->config;
+    struct pots_data *data = dev->data;
+
+    if (!data->running) return -EALREADY;
+
+#ifdef CONFIG_POTS_MOTION_WAKE
+    data->motion_armed = false;
+    data->restarting = false;
+    motion_limits_clear();
+#endif
+
+    nrfx_timer_disable(&trigger_timer);
+    nrfx_gppi_channels_disable(trigger_ppi_mask(data));
+
+    // the ADC driver set nrfx up once at boot and expects no mode or handler
+    // of ours, put it back into that state before handing the SAADC back
+    nrfx_saadc_uninit();
+    if (nrfx_saadc_init(DT_IRQ(DT_NODELABEL(adc), priority)) != NRFX_SUCCESS) {
+        LOG_ERR("SAADC reinit failed");
+    }
+    mixy_saadc_release();
+
+    nrfx_gpiote_out_task_disable(&gpiote, config->mux_psel);
+    gpio_pin_configure_dt(&config->mux, GPIO_OUTPUT_INACTIVE);
+
+    // the pin goes back to ext_power steadily on, then the claim is dropped
+    ext_power_gate(ext_power_dev, NULL);
+    ext_power_release(ext_power_dev);
+
+    data->running = false;
+    return 0;
+}
+
+#endif /* CONFIG_POTS_TRIGGER_HW */
+
+static void pots_frame_finish(const struct device *dev, int result) {
+    const struct pots_config *config = dev->config;
+    struct pots_data *data = dev->data;
+
+    gpio_pin_set_dt(&config->mux, 0);
+    atomic_inc(&data->releases);
+    k_work_submit_to_queue(&pots_work_q, &data->release_work);
+
+    k_spinlock_key_t key = k_spin_lock(&data->request_lock);
+    struct k_poll_signal *signal = data->signal;
+    if (data->sample_buf && result == 0) {
+        memcpy(data->sample_buf, data->scan_buf, sizeof(data->scan_buf));
+    }
+    data->sample_buf = NULL;
+    data->signal = NULL;
+    k_spin_unlock(&data->request_lock, key);
+
+    atomic_clear(&data->busy);
+    if (signal) k_poll_signal_raise(signal, result);
+}
+
+// SAADC completion context
+static void pots_sampling_done(uint8_t index, bool last, void *user_data) {
+    const struct device *dev = user_data;
+    const struct pots_config *config = dev->config;
+
+    if (last) {
+        pots_frame_finish(dev, 0);
+    } else {
+        gpio_pin_set_dt(&config->mux, 1);
+    }
+}
+
+static void pots_start_work_handler(struct k_work *work) {
+    struct pots_data *data = CONTAINER_OF(work, struct pots_data, start_work);
+    const struct device *dev = data->dev;
+    const struct pots_config *config = dev->config;
+
+    struct mixy_saadc_job job = {
+        .channels = bank_channels,
+        .buffer = (int16_t *)data->scan_buf,
+        .resolution = CONFIG_POTS_RESOLUTION,
+        // the ADC driver rejects oversampling with several channels, only
+        // the trigger chain averages
+        .oversampling = 0,
+        .samplings = 2,
+        .interval_us = config->bank_interval_us,
+    };
+
+    // assume all channels are on the same ADC
+    int ret = mixy_saadc_read_async(config->adc_specs[0].dev, &job, pots_sampling_done,
+                                    (void *)dev);
+    if (ret < 0) pots_frame_finish(dev, ret);
+}
+
+static void pots_release_work_handler(struct k_work *work) {
+    struct pots_data *data = CONTAINER_OF(work, struct pots_data, release_work);
+
+    // stays on for CONFIG_EXT_POWER_LINGER_MS in case the next scan follows soon
+    for (atomic_val_t n = atomic_clear(&data->releases); n > 0; n--) {
+        ext_power_release(ext_power_dev);
+    }
+}
+
+static void pots_settle_expired(struct k_timer *timer) {
+    struct pots_data *data = CONTAINER_OF(timer, struct pots_data, settle_timer);
+
+    // starting a conversion may wait for another SAADC job, not in an ISR
+    k_work_submit_to_queue(&pots_work_q, &data->start_work);
+}
+
+static int pots_read_async(const struct device *dev, uint16_t *sample_buf,
+                           struct k_poll_signal *signal) {
+    struct pots_data *data = dev->data;
+
+#ifdef CONFIG_POTS_TRIGGER_HW
+    // the SAADC belongs to the trigger chain while it runs, hand out its latest frame
+    if (data->running) {
+        if (data->last_frame == NULL) return -EAGAIN;
+
+        unsigned int key = irq_lock();
+        memcpy(sample_buf, data->last_frame, POTS_FRAME_LEN * sizeof(uint16_t));
+        irq_unlock(key);
+
+        if (signal) k_poll_signal_raise(signal, 0);
+        return 0;
+    }
+#endif
+
+    if (!atomic_cas(&data->busy, 0, 1)) return -EBUSY;
+
+    k_spinlock_key_t key = k_spin_lock(&data->request_lock);
+    data->sample_buf = sample_buf;
+    data->signal = signal;
+    k_spin_unlock(&data->request_lock, key);
+
+    int ret = ext_power_claim(ext_power_dev);
+    if (ret < 0) {
+        atomic_clear(&data->busy);
+        return ret;
+    }
+
+    // the mux already rests on bank A, only a rail that just came on needs time
+    if (ret > 0) {
+        k_timer_start(&data->settle_timer, K_USEC(POTS_POWER_SETTLE_US), K_NO_WAIT);
+    } else {
+        k_work_submit_to_queue(&pots_work_q, &data->start_work);
+    }
+
+    return 0;
+}
+
+static int pots_read(const struct device *dev, uint16_t *sample_buf) {
+    struct pots_data *data = dev->data;
+    struct k_poll_event event = K_POLL_EVENT_INITIALIZER(K_POLL_TYPE_SIGNAL,
+                                                         K_POLL_MODE_NOTIFY_ONLY,
+                                                         &data->read_signal);
+    unsigned int signaled;
+    int result;
+
+    k_poll_signal_reset(&data->read_signal);
+
+    int ret = pots_read_async(dev, sample_buf, &data->read_signal);
+    if (ret < 0) return ret;
+
+    // sleeps through the settle times and conversions instead of spinning
+    ret = k_poll(&event, 1, K_MSEC(CONFIG_POTS_READ_TIMEOUT_MS));
+    if (ret < 0) {
+        // the scan finishes into scan_buf alone, sample_buf is the caller's again
+        k_spinlock_key_t key = k_spin_lock(&data->request_lock);
+        bool pending = data->signal == &data->read_signal;
+        data->sample_buf = NULL;
+        data->signal = NULL;
+        k_spin_unlock(&data->request_lock, key);
+
+        // finished right between the timeout and the lock
+        if (!pending) {
+            k_poll_signal_check(&data->read_signal, &signaled, &result);
+            return signaled ? result : ret;
+        }
+        return ret;
+    }
+
+    k_poll_signal_check(&data->read_signal, &signaled, &result);
+    return result;
+}
+
 static DEVICE_API(pots, pots_api) = {
     .pots_read = &pots_read,
+    .pots_read_async = &pots_read_async,
+#ifdef CONFIG_POTS_TRIGGER_HW
+    .pots_start = &pots_start,
+    .pots_stop = &pots_stop,
+#endif
+#ifdef CONFIG_POTS_MOTION_WAKE
+    .pots_arm_motion = &pots_arm_motion,
+#endif
 };
 
 static int pots_init(const struct device *dev) {
     const struct pots_config *config = dev->config;
+    struct pots_data *data = dev->data;
+    static bool work_q_started;
+
+    if (!work_q_started) {
+        struct k_work_queue_config cfg = {.name = "pots"};
+
+        k_work_queue_start(&pots_work_q, pots_work_q_stack,
+                           K_THREAD_STACK_SIZEOF(pots_work_q_stack), CONFIG_POTS_WORKQ_PRIORITY,
+                           &cfg);
+        work_q_started = true;
+    }
+
+    data->dev = dev;
+    k_timer_init(&data->settle_timer, pots_settle_expired, NULL);
+    k_work_init(&data->start_work, pots_start_work_handler);
+    k_work_init(&data->release_work, pots_release_work_handler);
+    k_poll_signal_init(&data->read_signal);
 
     if (!gpio_is_ready_dt(&config->mux)) {
         LOG_ERR("Mux GPIO not ready");
@@ -65,36 +711,61 @@ static int pots_init(const struct device *dev) {
     int ret = gpio_pin_configure_dt(&config->mux, GPIO_OUTPUT_INACTIVE);
     if (ret < 0) return ret;
 
-    for (int i = 0; i < 3; i++) {
+    for (int i = 0; i < POTS_BANK_SIZE; i++) {
         if (!adc_is_ready_dt(&config->adc_specs[i])) return -ENODEV;
         struct adc_channel_cfg channel_cfg = {
             .channel_id = config->adc_specs[i].channel_id,
             .gain = ADC_GAIN_1_6,
             .reference = ADC_REF_INTERNAL,
-            .acquisition_time = ADC_ACQ_TIME(ADC_ACQ_TIME_MICROSECONDS, 40),
+#ifdef CONFIG_ADC_NRFX_SAADC
+            .acquisition_time = ADC_ACQ_TIME(ADC_ACQ_TIME_MICROSECONDS, POTS_ACQ_TIME_US),
+#else
+            .acquisition_time = ADC_ACQ_TIME_DEFAULT,
+#endif
+#ifdef CONFIG_ADC_CONFIGURABLE_INPUTS
             .input_positive = config->adc_specs[i].channel_id + 1,
+#endif
         };
-        ret = adc_channel_setup(config->adc_specs[i].dev, &channel_cfg);
+        ret = mixy_saadc_channel_setup(config->adc_specs[i].dev, &channel_cfg);
         if (ret < 0) return -ENODEV;
     }
 
-    for (int i = 0; i < 3; i++) {
+    for (int i = 0; i < POTS_BANK_SIZE; i++) {
         uint8_t ch = config->adc_specs[i].channel_id;
-        seq.channels |= BIT(ch);
+        bank_channels |= BIT(ch);
     }
 
+#ifdef CONFIG_POTS_TRIGGER_HW
+    ret = trigger_hw_init(dev);
+    if (ret < 0) {
+        LOG_ERR("Hardware trigger setup failed (%d)", ret);
+        return ret;
+    }
+#endif
+
     return 0;
 }
 
 #define DT_SPEC_AND_COMMA(node_id, prop, idx) ADC_DT_SPEC_GET_BY_IDX(node_id, idx),
 
+#define POTS_BANK_INTERVAL_US(inst)                                \
+    (DT_INST_PROP(inst, mux_settle_us) < POTS_ACQ_TIME_US              \
+         ? 0                                                           \
+         : POTS_BANK_TIME_US + DT_INST_PROP(inst, mux_settle_us))
+
 #define POTS_DRIVER_DEFINE(inst)                                \
+    BUILD_ASSERT(DT_INST_PROP_LEN(inst, io_channels) ==         \
+                 POTS_BANK_SIZE);                               \
     static struct pots_data pots_data_##inst;                   \
     static const struct adc_dt_spec pots_adc_specs_##inst[] = { \
         DT_FOREACH_PROP_ELEM(DT_DRV_INST(inst), io_channels,    \
                              DT_SPEC_AND_COMMA)};               \
     static const struct pots_config pots_config_##inst = {      \
         .mux = GPIO_DT_SPEC_INST_GET(inst, mux_gpios),          \
+        .bank_interval_us = POTS_BANK_INTERVAL_US(inst),        \
+        IF_ENABLED(CONFIG_POTS_TRIGGER_HW,                      \
+                   (.mux_psel = NRF_DT_GPIOS_TO_PSEL(           \
+                        DT_DRV_INST(inst), mux_gpios),))        \
         .adc_specs = pots_adc_specs_##inst};                    \
                                                                 \
     DEVICE_DT_INST_DEFINE(inst,                                 \
@@ -106,4 +777,4 @@ static int pots_init(const struct device *dev) {
                           CONFIG_POTS_INIT_PRIORITY,            \
                           &pots_api);
 
-DT_INST_FOREACH_STATUS_OKAY(POTS_DRIVER_DEFINE)
\ No newline at end of file
+DT_INST_FOREACH_STATUS_OKAY(POTS_DRIVER_DEFINE)
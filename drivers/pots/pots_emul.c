@@ -0,0 +1,120 @@
+#define DT_DRV_COMPAT mixy_pots
+
+#include <app/drivers/pots.h>
+#include <zephyr/device.h>
+#include <zephyr/devicetree.h>
+#include <zephyr/drivers/adc.h>
+#include <zephyr/drivers/adc/adc_emul.h>
+#include <zephyr/drivers/gpio.h>
+#include <zephyr/drivers/gpio/gpio_emul.h>
+#include <zephyr/init.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+
+LOG_MODULE_REGISTER(pots_emul, CONFIG_POTS_LOG_LEVEL);
+
+BUILD_ASSERT(DT_NUM_INST_STATUS_OKAY(DT_DRV_COMPAT) == 1,
+             "The pots emulator drives a single pots instance");
+
+#define POTS_NODE DT_DRV_INST(0)
+
+// what a pot at full travel puts on the ADC pin, reads ~930 at 10 bits
+#define POTS_EMUL_FULL_MV 3270
+
+static const struct adc_dt_spec adc_specs[] = {
+    DT_FOREACH_PROP_ELEM_SEP(POTS_NODE, io_channels, ADC_DT_SPEC_GET_BY_IDX, (,))};
+static const struct gpio_dt_spec mux = GPIO_DT_SPEC_GET(POTS_NODE, mux_gpios);
+static const struct gpio_dt_spec power = GPIO_DT_SPEC_GET(DT_NODELABEL(ext_power), control_gpios);
+
+static uint32_t noise_state = CONFIG_POTS_EMUL_SEED;
+
+// xorshift32, deterministic so runs can be compared against each other
+static int32_t noise_mv(void) {
+    noise_state ^= noise_state << 13;
+    noise_state ^= noise_state >> 17;
+    noise_state ^= noise_state << 5;
+
+    return (int32_t)(noise_state % (2 * CONFIG_POTS_EMUL_NOISE_MV + 1)) - CONFIG_POTS_EMUL_NOISE_MV;
+}
+
+// Triangle between 0 and full travel
+static int32_t ramp_mv(uint32_t t_ms, uint32_t period_ms) {
+    uint32_t phase = t_ms % period_ms;
+    uint32_t half = period_ms / 2;
+
+    if (phase >= half) phase = period_ms - phase;
+    return (int32_t)((uint64_t)POTS_EMUL_FULL_MV * phase / half);
+}
+
+// A new level every step_ms, like a pot being flicked to a position
+static int32_t steps_mv(int pot, uint32_t t_ms, uint32_t step_ms) {
+    uint32_t step = t_ms / step_ms + pot;
+
+    return (int32_t)((step * 7919U) % 8) * POTS_EMUL_FULL_MV / 7;
+}
+
+static int32_t waveform_mv(int pot, uint32_t t_ms) {
+    // pots move for the first half of every cycle and rest in the second,
+    // so both refresh modes get exercised
+    uint32_t cycle = t_ms / CONFIG_POTS_EMUL_CYCLE_MS;
+    uint32_t in_cycle = t_ms % CONFIG_POTS_EMUL_CYCLE_MS;
+    uint32_t moving_ms = CONFIG_POTS_EMUL_CYCLE_MS / 2;
+    uint32_t t = cycle * moving_ms + MIN(in_cycle, moving_ms);
+
+    // offset every pot so they do not move in lockstep
+    t += pot * 331;
+
+#if defined(CONFIG_POTS_EMUL_WAVEFORM_RAMP)
+    return ramp_mv(t, 2000);
+#elif defined(CONFIG_POTS_EMUL_WAVEFORM_STEPS)
+    return steps_mv(pot, t, 500);
+#elif defined(CONFIG_POTS_EMUL_WAVEFORM_NOISE)
+    return POTS_EMUL_FULL_MV / 2;
+#else
+    switch (pot) {
+    case 0:
+        return ramp_mv(t, 2000);
+    case 1:
+        return steps_mv(pot, t, 1000);
+    case 4:
+        return ramp_mv(t, 10000);
+    default:
+        return POTS_EMUL_FULL_MV / 2;
+    }
+#endif
+}
+
+static int pots_emul_value(const struct device *dev, unsigned int chan, void *data,
+                           uint32_t *result) {
+    int bank_pos = (int)(uintptr_t)data;
+
+    // unpowered pots read as ground
+    if (gpio_emul_output_get(power.port, power.pin) <= 0) {
+        *result = 0;
+        return 0;
+    }
+
+    int bank = gpio_emul_output_get(mux.port, mux.pin);
+    if (bank < 0) return bank;
+
+    int pot = bank * POTS_BANK_SIZE + bank_pos;
+    int32_t mv = waveform_mv(pot, k_uptime_get_32()) + noise_mv();
+
+    *result = CLAMP(mv, 0, POTS_EMUL_FULL_MV);
+    return 0;
+}
+
+static int pots_emul_init(void) {
+    for (int i = 0; i < ARRAY_SIZE(adc_specs); i++) {
+        int ret = adc_emul_value_func_set(adc_specs[i].dev, adc_specs[i].channel_id,
+                                          pots_emul_value, (void *)(uintptr_t)i);
+        if (ret < 0) {
+            LOG_ERR("Emulated channel %u setup failed (%d)", adc_specs[i].channel_id, ret);
+            return ret;
+        }
+    }
+
+    return 0;
+}
+
+SYS_INIT(pots_emul_init, POST_KERNEL, CONFIG_POTS_EMUL_INIT_PRIORITY);
@@ -1,5 +1,6 @@
 #define DT_DRV_COMPAT mixy_battery_nrf_vddh
 
+#include <app/drivers/mixy_saadc.h>
 #include <zephyr/device.h>
 #include <zephyr/devicetree.h>
 #include <zephyr/drivers/adc.h>
@@ -12,12 +13,32 @@ LOG_MODULE_REGISTER(mixy_battery, CONFIG_MIXY_LOG_LEVEL);
 
 static const struct device *adc = DEVICE_DT_GET(DT_NODELABEL(adc));
 
+#define VDDH_CHANNEL 1
+#define VDDH_RESOLUTION 12
+
 struct vddh_data {
     struct adc_channel_cfg acc;
-    struct adc_sequence as;
     struct battery_value value;
 };
 
+// Reuses the VDDH sample merged into a recent pots scan, or runs a job of its own
+static int vddh_raw_get(int16_t *raw, uint8_t *resolution) {
+    if (mixy_saadc_piggyback_get(VDDH_CHANNEL, raw, resolution,
+                                 CONFIG_MIXY_BATTERY_PIGGYBACK_INTERVAL_MS) == 0) {
+        return 0;
+    }
+
+    struct mixy_saadc_job job = {
+        .channels = BIT(VDDH_CHANNEL),
+        .buffer = raw,
+        .resolution = VDDH_RESOLUTION,
+        .oversampling = 4,
+    };
+    *resolution = VDDH_RESOLUTION;
+
+    return mixy_saadc_read(adc, &job);
+}
+
 static int vddh_sample_fetch(const struct device *dev, enum sensor_channel chan) {
     // Make sure selected channel is supported
     if (chan != SENSOR_CHAN_GAUGE_VOLTAGE && chan != SENSOR_CHAN_GAUGE_STATE_OF_CHARGE &&
@@ -27,18 +48,19 @@ static int vddh_sample_fetch(const struct device *dev, enum sensor_channel chan)
     }
 
     struct vddh_data *drv_data = dev->data;
-    struct adc_sequence *as = &drv_data->as;
-
-    int rc = adc_read(adc, as);
-    as->calibrate = false;
+    int16_t raw;
+    uint8_t resolution;
 
+    int rc = vddh_raw_get(&raw, &resolution);
     if (rc != 0) {
         LOG_ERR("Failed to read ADC: %d", rc);
         return rc;
     }
 
-    int32_t val = drv_data->value.adc_raw;
-    rc = adc_raw_to_millivolts(adc_ref_internal(adc), drv_data->acc.gain, as->resolution, &val);
+    drv_data->value.adc_raw = MAX(raw, 0);
+
+    int32_t val = raw;
+    rc = adc_raw_to_millivolts(adc_ref_internal(adc), drv_data->acc.gain, resolution, &val);
     if (rc != 0) {
         LOG_ERR("Failed to convert raw ADC to mV: %d", rc);
         return rc;
@@ -72,18 +94,9 @@ static int vddh_init(const struct device *dev) {
         return -ENODEV;
     }
 
-    drv_data->as = (struct adc_sequence){
-        .channels = BIT(1),
-        .buffer = &drv_data->value.adc_raw,
-        .buffer_size = sizeof(drv_data->value.adc_raw),
-        .oversampling = 4,
-        .resolution = 12,
-        .calibrate = true,
-    };
-
 #ifdef CONFIG_ADC_NRFX_SAADC
     drv_data->acc = (struct adc_channel_cfg){
-        .channel_id = 1,
+        .channel_id = VDDH_CHANNEL,
         .gain = ADC_GAIN_1_6,
         .reference = ADC_REF_INTERNAL,
         .acquisition_time = ADC_ACQ_TIME(ADC_ACQ_TIME_MICROSECONDS, 40),
@@ -94,10 +107,12 @@ static int vddh_init(const struct device *dev) {
 #error Unsupported ADC
 #endif
 
-    const int rc = adc_channel_setup(adc, &drv_data->acc);
+    int rc = mixy_saadc_channel_setup(adc, &drv_data->acc);
     LOG_DBG("VDDHDIV5 setup returned %d", rc);
+    if (rc != 0) return rc;
 
-    return rc;
+    // battery readings are rare, let the pots scans carry them
+    return mixy_saadc_piggyback(VDDH_CHANNEL, CONFIG_MIXY_BATTERY_PIGGYBACK_INTERVAL_MS);
 }
 
 static struct vddh_data vddh_data;
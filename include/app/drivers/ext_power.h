@@ -2,23 +2,92 @@
 #define APP_DRIVERS_EXT_POWER_H_
 
 #include <zephyr/device.h>
+#include <zephyr/kernel.h>
+#include <zephyr/pm/device.h>
+#include <zephyr/pm/device_runtime.h>
 #include <zephyr/toolchain.h>
 
+/*
+ * Hardware switching the rail every frame for one claimer, e.g. a timer
+ * driving the pin through GPIOTE. It is only handed the pin while that
+ * claimer is the rail's only user, any other claim keeps the rail steadily
+ * on until it is released.
+ */
+struct ext_power_gate {
+    /* Hand the pin to the gate or take it back, called from any context */
+    void (*set)(bool gated, void *user_data);
+    void *user_data;
+    // while gated the rail is on for on_us at the start of every period_us
+    uint32_t on_us;
+    uint32_t period_us;
+};
+
 __subsystem struct ext_power_driver_api {
-    int (*set_state)(const struct device *dev, int state);
+    uint32_t (*get_on_time)(const struct device *dev);
+    uint32_t (*get_on_count)(const struct device *dev);
+    void (*gate)(const struct device *dev, const struct ext_power_gate *gate);
+    int (*claims_changed)(const struct device *dev);
 };
 
-__syscall int ext_power_set_state(const struct device *dev,
-                                  int state);
+/* Total time the output has been on since boot, in milliseconds */
+__syscall uint32_t ext_power_get_on_time_ms(const struct device *dev);
 
-static inline int z_impl_ext_power_set_state(const struct device *dev, int state) {
+static inline uint32_t z_impl_ext_power_get_on_time_ms(const struct device *dev) {
     __ASSERT_NO_MSG(DEVICE_API_IS(ext_power, dev));
 
-    return DEVICE_API_GET(ext_power, dev)->set_state(dev, state);
+    return DEVICE_API_GET(ext_power, dev)->get_on_time(dev);
+}
+
+/* Times the output has been switched on since boot */
+__syscall uint32_t ext_power_get_on_count(const struct device *dev);
+
+static inline uint32_t z_impl_ext_power_get_on_count(const struct device *dev) {
+    __ASSERT_NO_MSG(DEVICE_API_IS(ext_power, dev));
+
+    return DEVICE_API_GET(ext_power, dev)->get_on_count(dev);
 }
 
 #include <syscalls/ext_power.h>
 
+/**
+ * Take a reference on the rail, it is on when this returns. Returns 1 when
+ * it was switched on for this claim and consumers must wait
+ * startup-delay-us, 0 when it was on already.
+ */
+static inline int ext_power_claim(const struct device *dev) {
+    // counted by the resume action itself, a linger ending right before the
+    // get shows up as a new switch on
+    uint32_t on_count = ext_power_get_on_count(dev);
+
+    int ret = pm_device_runtime_get(dev);
+    if (ret < 0) return ret;
+
+    // taken back from a gate, the rail may have been off between frames
+    if (DEVICE_API_GET(ext_power, dev)->claims_changed(dev)) return 1;
+
+    return ext_power_get_on_count(dev) != on_count;
+}
+
+/**
+ * Drop a reference. The rail goes off CONFIG_EXT_POWER_LINGER_MS after the
+ * last one, unless it is claimed again in the meantime.
+ */
+static inline int ext_power_release(const struct device *dev) {
+    int ret = pm_device_runtime_put_async(dev, K_MSEC(CONFIG_EXT_POWER_LINGER_MS));
+
+    DEVICE_API_GET(ext_power, dev)->claims_changed(dev);
+    return ret;
+}
+
+/**
+ * Register the gate of a claimer, or update its timing, NULL removes it and
+ * leaves the rail steadily on. On time and switch ons while gated are
+ * counted from the gate's timing.
+ */
+static inline void ext_power_gate(const struct device *dev, const struct ext_power_gate *gate) {
+    DEVICE_API_GET(ext_power, dev)->gate(dev, gate);
+}
+
 /** @} */
 
 /** @} */
@@ -0,0 +1,70 @@
+#ifndef APP_DRIVERS_MIXY_SAADC_H_
+#define APP_DRIVERS_MIXY_SAADC_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <zephyr/device.h>
+#include <zephyr/drivers/adc.h>
+#include <zephyr/kernel.h>
+
+/*
+ * Shared access to the SAADC for all drivers sampling it. Channel
+ * configuration is kept here and only written to the peripheral when it
+ * changed, calibration runs once, channels registered for piggybacking are
+ * added to other jobs when due, and the peripheral is released after every
+ * job.
+ */
+
+struct mixy_saadc_job {
+    uint32_t channels;
+    /* one sample per channel and sampling, in ascending channel order */
+    int16_t *buffer;
+    uint8_t resolution;
+    uint8_t oversampling;
+    /* back to back samplings of the channels, 0 is taken as 1 */
+    uint8_t samplings;
+    /* between sampling starts, 0 starts the next one right after the callback */
+    uint32_t interval_us;
+};
+
+/*
+ * Called from the ADC's completion context (an interrupt on the SAADC) after
+ * every sampling, once its samples are in the job buffer. Anything done here,
+ * like switching a mux, happens before the next sampling starts.
+ */
+typedef void (*mixy_saadc_sampling_cb_t)(uint8_t index, bool last, void *user_data);
+
+int mixy_saadc_channel_setup(const struct device *adc, const struct adc_channel_cfg *cfg);
+
+/* Run one conversion job, blocking until it is done. -EBUSY while claimed. */
+int mixy_saadc_read(const struct device *adc, const struct mixy_saadc_job *job);
+
+#ifdef CONFIG_ADC_ASYNC
+/*
+ * Start a job and return right away, cb reports every sampling. Waits only
+ * for a job that is already running.
+ */
+int mixy_saadc_read_async(const struct device *adc, const struct mixy_saadc_job *job,
+                          mixy_saadc_sampling_cb_t cb, void *user_data);
+#endif
+
+/* Add the channel to other jobs at most every interval_ms */
+int mixy_saadc_piggyback(uint8_t channel, uint32_t interval_ms);
+
+/*
+ * Latest piggybacked sample of the channel and the resolution it was taken
+ * at, -EAGAIN if there is none younger than max_age_ms.
+ */
+int mixy_saadc_piggyback_get(uint8_t channel, int16_t *sample, uint8_t *resolution,
+                             uint32_t max_age_ms);
+
+/*
+ * Take the SAADC over for direct peripheral access, e.g. a hardware
+ * triggered chain. timeout bounds the wait for a running job. Jobs fail
+ * with -EBUSY until it is released, channels are configured again
+ * afterwards.
+ */
+int mixy_saadc_claim(k_timeout_t timeout);
+void mixy_saadc_release(void);
+
+#endif /* APP_DRIVERS_MIXY_SAADC_H_ */
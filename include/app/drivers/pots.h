@@ -1,14 +1,37 @@
 #ifndef APP_DRIVERS_POTS_H_
 #define APP_DRIVERS_POTS_H_
 
+#include <errno.h>
 #include <zephyr/device.h>
+#include <zephyr/kernel.h>
 #include <zephyr/toolchain.h>
 
-struct pots_data {
+/* Two mux banks of three ADC channels each */
+#define POTS_BANK_SIZE 3
+#define POTS_FRAME_LEN (2 * POTS_BANK_SIZE)
+
+struct pots_frame {
+	/* POTS_FRAME_LEN samples, bank A followed by bank B */
+	const uint16_t *samples;
+	/* k_uptime_get_32() when the SAADC finished the frame */
+	uint32_t timestamp_ms;
+	/* time from the first conversion to the end of the frame */
+	uint32_t duration_us;
 };
 
+/* Called from the SAADC interrupt once a full frame has been converted */
+typedef void (*pots_frame_cb_t)(const struct device *dev, const struct pots_frame *frame,
+				void *user_data);
+
 __subsystem struct pots_driver_api {
 	int (*pots_read)(const struct device *dev, uint16_t *sample_buf);
+	int (*pots_read_async)(const struct device *dev, uint16_t *sample_buf,
+			       struct k_poll_signal *signal);
+	int (*pots_start)(const struct device *dev, uint32_t period_us, pots_frame_cb_t cb,
+			  void *user_data);
+	int (*pots_stop)(const struct device *dev);
+	int (*pots_arm_motion)(const struct device *dev, uint16_t deadband,
+			       uint32_t wake_period_us);
 };
 
 
@@ -21,6 +44,69 @@ static inline int z_impl_mixy_pots_read(const struct device *dev, uint16_t *samp
 	return DEVICE_API_GET(pots, dev)->pots_read(dev, sample_buf);
 }
 
+/**
+ * Start a scan into sample_buf and return right away. The signal is raised
+ * with the result once the frame is complete, sample_buf must stay valid
+ * until then. -EBUSY while a scan is running.
+ */
+static inline int mixy_pots_read_async(const struct device *dev, uint16_t *sample_buf,
+				       struct k_poll_signal *signal)
+{
+	__ASSERT_NO_MSG(DEVICE_API_IS(pots, dev));
+
+	if (DEVICE_API_GET(pots, dev)->pots_read_async == NULL) {
+		return -ENOSYS;
+	}
+
+	return DEVICE_API_GET(pots, dev)->pots_read_async(dev, sample_buf, signal);
+}
+
+/**
+ * Start hardware triggered sampling, one frame every period_us.
+ * Calling it again while running only updates the period and callback.
+ */
+static inline int mixy_pots_start(const struct device *dev, uint32_t period_us,
+				  pots_frame_cb_t cb, void *user_data)
+{
+	__ASSERT_NO_MSG(DEVICE_API_IS(pots, dev));
+
+	if (DEVICE_API_GET(pots, dev)->pots_start == NULL) {
+		return -ENOSYS;
+	}
+
+	return DEVICE_API_GET(pots, dev)->pots_start(dev, period_us, cb, user_data);
+}
+
+static inline int mixy_pots_stop(const struct device *dev)
+{
+	__ASSERT_NO_MSG(DEVICE_API_IS(pots, dev));
+
+	if (DEVICE_API_GET(pots, dev)->pots_stop == NULL) {
+		return -ENOSYS;
+	}
+
+	return DEVICE_API_GET(pots, dev)->pots_stop(dev);
+}
+
+/**
+ * Keep hardware triggered sampling running, but only hand frames to the
+ * callback once a pot moved more than deadband (raw units) from the latest
+ * frame, or as a heartbeat every CONFIG_POTS_MOTION_HEARTBEAT_FRAMES frames.
+ * After motion sampling continues every wake_period_us and the arming is
+ * dropped, call again to go back to sleep.
+ */
+static inline int mixy_pots_arm_motion(const struct device *dev, uint16_t deadband,
+				       uint32_t wake_period_us)
+{
+	__ASSERT_NO_MSG(DEVICE_API_IS(pots, dev));
+
+	if (DEVICE_API_GET(pots, dev)->pots_arm_motion == NULL) {
+		return -ENOSYS;
+	}
+
+	return DEVICE_API_GET(pots, dev)->pots_arm_motion(dev, deadband, wake_period_us);
+}
+
 #include <syscalls/pots.h>
 
 #endif /* APP_DRIVERS_POTS_H_ */
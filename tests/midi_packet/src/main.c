@@ -0,0 +1,163 @@
+#include <errno.h>
+#include <zephyr/ztest.h>
+
+#include "midi_packet.h"
+
+#define TS_HEADER(ts) (0x80 | (((ts) >> 7) & 0x3F))
+#define TS_LOW(ts) (0x80 | ((ts) & 0x7F))
+
+static struct midi_packet pkt;
+
+static void before(void *fixture) {
+    ARG_UNUSED(fixture);
+    midi_packet_init(&pkt, MIDI_PACKET_MAX_LEN);
+}
+
+ZTEST(midi_packet, test_first_event) {
+    const uint8_t expected[] = {TS_HEADER(1000), TS_LOW(1000), 0xB2, 7, 100};
+
+    zassert_true(midi_packet_is_empty(&pkt));
+    zassert_ok(midi_packet_add_cc(&pkt, 1000, 2, 7, 100));
+    zassert_equal(pkt.len, sizeof(expected));
+    zassert_mem_equal(pkt.data, expected, sizeof(expected));
+}
+
+ZTEST(midi_packet, test_running_status_shared_timestamp) {
+    zassert_ok(midi_packet_add_cc(&pkt, 1000, 0, 1, 10));
+    zassert_ok(midi_packet_add_cc(&pkt, 1000, 0, 2, 20));
+
+    if (IS_ENABLED(CONFIG_APP_MIDI_RUNNING_STATUS)) {
+        // status and timestamp both left out
+        const uint8_t expected[] = {TS_HEADER(1000), TS_LOW(1000), 0xB0, 1, 10, 2, 20};
+
+        zassert_equal(pkt.len, sizeof(expected));
+        zassert_mem_equal(pkt.data, expected, sizeof(expected));
+    } else {
+        const uint8_t expected[] = {TS_HEADER(1000), TS_LOW(1000), 0xB0, 1, 10,
+                                    TS_LOW(1000),    0xB0,         2,    20};
+
+        zassert_equal(pkt.len, sizeof(expected));
+        zassert_mem_equal(pkt.data, expected, sizeof(expected));
+    }
+}
+
+ZTEST(midi_packet, test_running_status_new_timestamp) {
+    zassert_ok(midi_packet_add_cc(&pkt, 1000, 0, 1, 10));
+    zassert_ok(midi_packet_add_cc(&pkt, 1005, 0, 2, 20));
+
+    if (IS_ENABLED(CONFIG_APP_MIDI_RUNNING_STATUS)) {
+        // a new timestamp byte, still no status byte
+        const uint8_t expected[] = {TS_HEADER(1000), TS_LOW(1000), 0xB0, 1, 10,
+                                    TS_LOW(1005),    2,            20};
+
+        zassert_equal(pkt.len, sizeof(expected));
+        zassert_mem_equal(pkt.data, expected, sizeof(expected));
+    } else {
+        const uint8_t expected[] = {TS_HEADER(1000), TS_LOW(1000), 0xB0, 1, 10,
+                                    TS_LOW(1005),    0xB0,         2,    20};
+
+        zassert_equal(pkt.len, sizeof(expected));
+        zassert_mem_equal(pkt.data, expected, sizeof(expected));
+    }
+}
+
+ZTEST(midi_packet, test_status_change) {
+    const uint8_t expected[] = {TS_HEADER(1000), TS_LOW(1000), 0xB0, 1, 10,
+                                TS_LOW(1000),    0xB1,         1,    10};
+
+    zassert_ok(midi_packet_add_cc(&pkt, 1000, 0, 1, 10));
+    zassert_ok(midi_packet_add_cc(&pkt, 1000, 1, 1, 10));
+    zassert_equal(pkt.len, sizeof(expected));
+    zassert_mem_equal(pkt.data, expected, sizeof(expected));
+}
+
+ZTEST(midi_packet, test_new_packet_repeats_status) {
+    zassert_ok(midi_packet_add_cc(&pkt, 1000, 0, 1, 10));
+
+    midi_packet_init(&pkt, MIDI_PACKET_MAX_LEN);
+    zassert_ok(midi_packet_add_cc(&pkt, 1000, 0, 2, 20));
+    zassert_equal(pkt.len, 5);
+    zassert_equal(pkt.data[2], 0xB0);
+}
+
+ZTEST(midi_packet, test_header_wrap) {
+    // low 7 bits go backwards once, the receiver bumps the header's high bits
+    zassert_ok(midi_packet_add_cc(&pkt, 0x00FF, 0, 1, 10));
+    zassert_ok(midi_packet_add_cc(&pkt, 0x0100, 0, 2, 20));
+    zassert_equal(pkt.data[0], TS_HEADER(0x00FF));
+
+    // the 8192 ms rollover wraps the same way
+    midi_packet_init(&pkt, MIDI_PACKET_MAX_LEN);
+    zassert_ok(midi_packet_add_cc(&pkt, 0x1FFF, 0, 1, 10));
+    zassert_ok(midi_packet_add_cc(&pkt, 0x2000, 0, 2, 20));
+}
+
+ZTEST(midi_packet, test_header_out_of_range) {
+    zassert_ok(midi_packet_add_cc(&pkt, 0x0100, 0, 1, 10));
+
+    struct midi_packet_mark mark = midi_packet_mark(&pkt);
+
+    // a full header step ahead without the low bits wrapping
+    zassert_equal(midi_packet_add_cc(&pkt, 0x0180, 0, 2, 20), -ERANGE);
+    // two wraps ahead
+    zassert_equal(midi_packet_add_cc(&pkt, 0x0200, 0, 2, 20), -ERANGE);
+    // behind the previous event
+    zassert_equal(midi_packet_add_cc(&pkt, 0x00FF, 0, 2, 20), -ERANGE);
+
+    zassert_equal(pkt.len, mark.len);
+    zassert_equal(pkt.last_timestamp, mark.last_timestamp);
+    zassert_equal(pkt.last_status, mark.last_status);
+}
+
+ZTEST(midi_packet, test_full_packet) {
+    // header, timestamp and one full event
+    midi_packet_init(&pkt, 8);
+    zassert_ok(midi_packet_add_cc(&pkt, 1000, 0, 1, 10));
+    zassert_equal(pkt.len, 5);
+
+    // a full event takes 4 more bytes
+    zassert_equal(midi_packet_add_cc(&pkt, 1000, 1, 1, 10), -ENOMEM);
+    zassert_equal(pkt.len, 5);
+
+    if (IS_ENABLED(CONFIG_APP_MIDI_RUNNING_STATUS)) {
+        // running status with the same timestamp only needs 2 bytes
+        zassert_ok(midi_packet_add_cc(&pkt, 1000, 0, 2, 20));
+        zassert_equal(pkt.len, 7);
+        zassert_equal(midi_packet_add_cc(&pkt, 1000, 0, 3, 30), -ENOMEM);
+        zassert_equal(pkt.len, 7);
+    }
+}
+
+ZTEST(midi_packet, test_max_len_clamped) {
+    midi_packet_init(&pkt, SIZE_MAX);
+    zassert_equal(pkt.max_len, MIDI_PACKET_MAX_LEN);
+
+    int ret;
+    uint8_t controller = 0;
+    do {
+        // alternating channels, every event carries its status byte
+        ret = midi_packet_add_cc(&pkt, 1000, controller & 1, controller, 0);
+        controller++;
+    } while (ret == 0);
+
+    zassert_equal(ret, -ENOMEM);
+    zassert_true(pkt.len <= MIDI_PACKET_MAX_LEN);
+    zassert_true(pkt.len + 4 > MIDI_PACKET_MAX_LEN);
+}
+
+ZTEST(midi_packet, test_cc_assignable) {
+    zassert_true(midi_cc_assignable(0));
+    zassert_true(midi_cc_assignable(MIDI_CC_LSB_OFFSET - 1));
+    zassert_false(midi_cc_assignable(128));
+
+    if (IS_ENABLED(CONFIG_APP_CC_14BIT)) {
+        // the LSB of CC 32 and up would go out on another MSB controller or beyond 127
+        zassert_false(midi_cc_assignable(MIDI_CC_LSB_OFFSET));
+        zassert_false(midi_cc_assignable(127));
+    } else {
+        zassert_true(midi_cc_assignable(MIDI_CC_LSB_OFFSET));
+        zassert_true(midi_cc_assignable(127));
+    }
+}
+
+ZTEST_SUITE(midi_packet, NULL, NULL, before, NULL, NULL);
@@ -0,0 +1,86 @@
+#include <app/drivers/pots.h>
+#include <zephyr/kernel.h>
+#include <zephyr/ztest.h>
+
+#include "diag.h"
+
+// the app's main(), renamed by the build
+int mixy_main(void);
+
+static K_THREAD_STACK_DEFINE(mixy_stack, CONFIG_MAIN_STACK_SIZE);
+static struct k_thread mixy_thread;
+
+struct window {
+    uint32_t scans;
+    uint32_t events;
+    uint32_t bytes;
+    uint32_t notifies;
+};
+
+static void mixy_entry(void *p1, void *p2, void *p3) {
+    mixy_main();
+}
+
+// Counter deltas over len of simulated time
+static void window_measure(struct window *w, k_timeout_t len) {
+    uint32_t scans = atomic_get(&diag_counters[DIAG_SCANS]);
+    uint32_t events = atomic_get(&diag_counters[DIAG_MIDI_EVENTS]);
+    uint32_t bytes = atomic_get(&diag_counters[DIAG_MIDI_BYTES]);
+    uint32_t notifies = atomic_get(&diag_counters[DIAG_NOTIFY_SENT]);
+
+    k_sleep(len);
+
+    w->scans = atomic_get(&diag_counters[DIAG_SCANS]) - scans;
+    w->events = atomic_get(&diag_counters[DIAG_MIDI_EVENTS]) - events;
+    w->bytes = atomic_get(&diag_counters[DIAG_MIDI_BYTES]) - bytes;
+    w->notifies = atomic_get(&diag_counters[DIAG_NOTIFY_SENT]) - notifies;
+
+    TC_PRINT("scans=%u events=%u bytes=%u notifies=%u\n", w->scans, w->events, w->bytes,
+             w->notifies);
+}
+
+ZTEST(pipeline, test_moving) {
+    struct window w;
+
+    if (!IS_ENABLED(CONFIG_POTS_EMUL_WAVEFORM_RAMP)) ztest_test_skip();
+
+    // past the initial sync and the switch to fast refresh
+    k_sleep(K_MSEC(500));
+    window_measure(&w, K_MSEC(2000));
+
+    zassert_true(w.scans > 0);
+    zassert_true(w.notifies > 0 && w.notifies <= w.scans, "one notification per scan at most");
+
+    // every pot ramps further than the deadband between fast scans
+    zassert_between_inclusive(w.events, w.scans * POTS_FRAME_LEN / 2, w.scans * POTS_FRAME_LEN);
+
+    if (IS_ENABLED(CONFIG_APP_MIDI_RUNNING_STATUS)) {
+        // events of one scan share status and timestamp, only the first carries them
+        zassert_between_inclusive(w.bytes, 2 * w.events, 3 * w.events);
+    } else {
+        zassert_between_inclusive(w.bytes, 4 * w.events, 5 * w.events);
+    }
+}
+
+ZTEST(pipeline, test_idle) {
+    struct window w;
+
+    if (!IS_ENABLED(CONFIG_POTS_EMUL_WAVEFORM_NOISE)) ztest_test_skip();
+
+    // past the initial sync
+    k_sleep(K_MSEC(1000));
+    window_measure(&w, K_MSEC(3000));
+
+    // noise stays within the deadband, scanning goes on without sending
+    zassert_true(w.scans > 0);
+    zassert_equal(w.events, 0);
+    zassert_equal(w.notifies, 0);
+}
+
+static void *pipeline_setup(void) {
+    k_thread_create(&mixy_thread, mixy_stack, K_THREAD_STACK_SIZEOF(mixy_stack), mixy_entry,
+                    NULL, NULL, NULL, CONFIG_MAIN_THREAD_PRIORITY, 0, K_NO_WAIT);
+    return NULL;
+}
+
+ZTEST_SUITE(pipeline, NULL, pipeline_setup, NULL, NULL, NULL);
@@ -0,0 +1,333 @@
+/*
+ * BabbleSim central for benchmarking Mixy over a simulated radio.
+ * Connects to the first device advertising BLE-MIDI, applies the
+ * pots_params preset, subscribes to MIDI and reports throughput and
+ * sample-to-receive latency after BENCH_DURATION_S.
+ *
+ * Both simulated devices boot at the same simulated instant, so their
+ * uptime clocks agree and the BLE-MIDI timestamps can be compared
+ * directly with the local uptime.
+ */
+
+#include <string.h>
+#include <zephyr/bluetooth/bluetooth.h>
+#include <zephyr/bluetooth/conn.h>
+#include <zephyr/bluetooth/gatt.h>
+#include <zephyr/kernel.h>
+#include <zephyr/sys/byteorder.h>
+#include <zephyr/sys/printk.h>
+
+#include "ble_midi.h"
+#include "diag.h"
+#include "mixy_uuid.h"
+
+#define MIDI_TS_MASK 0x1FFF
+#define LATENCY_BUCKETS 256  // 1 ms each, the last one collects everything above
+
+static struct bt_conn *mixy_conn;
+static uint16_t midi_handle;
+static uint16_t diag_handle;
+
+static struct bt_gatt_discover_params discover_params;
+static struct bt_gatt_discover_params ccc_discover_params;
+static struct bt_gatt_subscribe_params subscribe_params;
+static struct bt_gatt_read_params read_params;
+
+static uint32_t start_ms;
+static uint32_t notifications;
+static uint32_t events;
+static uint32_t bytes;
+static uint32_t latency_counts[LATENCY_BUCKETS];
+static uint64_t latency_sum;
+static uint32_t latency_max;
+
+static void report_work_handler(struct k_work *work);
+static K_WORK_DELAYABLE_DEFINE(report_work, report_work_handler);
+
+static void latency_add(uint16_t sample_ts) {
+    uint32_t latency = ((k_uptime_get_32() & MIDI_TS_MASK) - sample_ts) & MIDI_TS_MASK;
+
+    latency_counts[MIN(latency, LATENCY_BUCKETS - 1)]++;
+    latency_sum += latency;
+    latency_max = MAX(latency_max, latency);
+}
+
+static uint32_t latency_percentile(int percent) {
+    uint32_t target = DIV_ROUND_UP(events * percent, 100);
+    uint32_t seen = 0;
+
+    for (int i = 0; i < LATENCY_BUCKETS; i++) {
+        seen += latency_counts[i];
+        if (seen >= target) return i;
+    }
+    return LATENCY_BUCKETS - 1;
+}
+
+// Walk a BLE-MIDI packet, every 2 byte controller message is one event.
+// A timestamp byte may be followed by a status byte or, with running
+// status, directly by data. Data may also follow without a timestamp.
+static void midi_parse(const uint8_t *data, uint16_t len) {
+    if (len < 1 || !(data[0] & 0x80)) return;
+
+    uint16_t ts_high = data[0] & 0x3F;
+    uint8_t ts_low = 0;
+    bool have_ts = false;
+
+    for (uint16_t i = 1; i < len;) {
+        if (data[i] & 0x80) {
+            uint8_t low = data[i] & 0x7F;
+            // the low byte wrapped within the packet
+            if (have_ts && low < ts_low) ts_high = (ts_high + 1) & 0x3F;
+            ts_low = low;
+            have_ts = true;
+            i++;
+            if (i < len && (data[i] & 0x80)) i++;  // status
+        }
+
+        if (i + 2 > len) break;
+
+        events++;
+        latency_add((ts_high << 7) | ts_low);
+        i += 2;
+    }
+}
+
+static uint8_t midi_notified(struct bt_conn *conn, struct bt_gatt_subscribe_params *params,
+                             const void *data, uint16_t length) {
+    if (!data) return BT_GATT_ITER_STOP;
+
+    notifications++;
+    bytes += length;
+    midi_parse(data, length);
+    return BT_GATT_ITER_CONTINUE;
+}
+
+static void report(uint32_t dropped, uint32_t deferred) {
+    uint32_t elapsed_ms = k_uptime_get_32() - start_ms;
+    uint32_t interval_us = CONFIG_BENCH_CONN_INTERVAL * 1250;
+
+    printk("bsim bench: interval_us=%u params=%u/%u/%u/%u duration_ms=%u\n", interval_us,
+           CONFIG_BENCH_MIN_CHANGE, CONFIG_BENCH_SLOW_REFRESH_MS, CONFIG_BENCH_FAST_REFRESH_MS,
+           CONFIG_BENCH_FAST_RETENTION_MS, elapsed_ms);
+    printk("bsim bench: notifications=%u notifications/s=%u events=%u events/notification=%u.%02u "
+           "bytes=%u dropped=%u deferred=%u\n",
+           notifications, (uint32_t)((uint64_t)notifications * MSEC_PER_SEC / MAX(elapsed_ms, 1)),
+           events, notifications ? events / notifications : 0,
+           notifications ? (events * 100 / notifications) % 100 : 0, bytes, dropped, deferred);
+    printk("bsim bench: latency_ms mean=%u p50=%u p99=%u max=%u\n",
+           events ? (uint32_t)(latency_sum / events) : 0, latency_percentile(50),
+           latency_percentile(99), latency_max);
+}
+
+static uint8_t diag_read(struct bt_conn *conn, uint8_t err, struct bt_gatt_read_params *params,
+                         const void *data, uint16_t length) {
+    uint32_t dropped = 0;
+    uint32_t deferred = 0;
+
+    if (!err && data && length >= (DIAG_NOTIFY_DROPPED + 1) * sizeof(uint32_t)) {
+        dropped = sys_get_le32((const uint8_t *)data + DIAG_NOTIFY_DROPPED * sizeof(uint32_t));
+    }
+    // older firmware has no such counter yet
+    if (!err && data && length >= (DIAG_NOTIFY_DEFERRED + 1) * sizeof(uint32_t)) {
+        deferred = sys_get_le32((const uint8_t *)data + DIAG_NOTIFY_DEFERRED * sizeof(uint32_t));
+    }
+
+    report(dropped, deferred);
+    return BT_GATT_ITER_STOP;
+}
+
+// Drops are counted on the Mixy side, fetch them from the diagnostics service
+static void report_work_handler(struct k_work *work) {
+    if (!mixy_conn || !diag_handle) {
+        report(0, 0);
+        return;
+    }
+
+    read_params.func = diag_read;
+    read_params.handle_count = 1;
+    read_params.single.handle = diag_handle;
+    read_params.single.offset = 0;
+
+    if (bt_gatt_read(mixy_conn, &read_params)) {
+        report(0, 0);
+    }
+}
+
+static void subscribe(void) {
+    subscribe_params.notify = midi_notified;
+    subscribe_params.value = BT_GATT_CCC_NOTIFY;
+    subscribe_params.value_handle = midi_handle;
+    subscribe_params.ccc_handle = 0;
+    subscribe_params.end_handle = BT_ATT_LAST_ATTRIBUTE_HANDLE;
+    subscribe_params.disc_params = &ccc_discover_params;
+
+    int err = bt_gatt_subscribe(mixy_conn, &subscribe_params);
+    if (err) {
+        printk("Subscribe failed (err %d)\n", err);
+        return;
+    }
+
+    start_ms = k_uptime_get_32();
+    k_work_schedule(&report_work, K_SECONDS(CONFIG_BENCH_DURATION_S));
+}
+
+static void write_params(void) {
+    uint8_t value[8];
+
+    sys_put_le16(CONFIG_BENCH_MIN_CHANGE, &value[0]);
+    sys_put_le16(CONFIG_BENCH_SLOW_REFRESH_MS, &value[2]);
+    sys_put_le16(CONFIG_BENCH_FAST_REFRESH_MS, &value[4]);
+    sys_put_le16(CONFIG_BENCH_FAST_RETENTION_MS, &value[6]);
+
+    int err = bt_gatt_write_without_response(mixy_conn, midi_handle, value, sizeof(value), false);
+    if (err) {
+        printk("Params write failed (err %d)\n", err);
+    }
+}
+
+// Reading the MIDI characteristic is what starts MIDI on Mixy
+static uint8_t midi_read(struct bt_conn *conn, uint8_t err, struct bt_gatt_read_params *params,
+                         const void *data, uint16_t length) {
+    if (err) {
+        printk("MIDI read failed (err %u)\n", err);
+        return BT_GATT_ITER_STOP;
+    }
+
+    write_params();
+    subscribe();
+    return BT_GATT_ITER_STOP;
+}
+
+static void midi_start(void) {
+    read_params.func = midi_read;
+    read_params.handle_count = 1;
+    read_params.single.handle = midi_handle;
+    read_params.single.offset = 0;
+
+    int err = bt_gatt_read(mixy_conn, &read_params);
+    if (err) {
+        printk("MIDI read request failed (err %d)\n", err);
+    }
+}
+
+static const struct bt_uuid *const wanted_chars[] = {
+    BT_UUID_MIDI_CHAR,
+    BT_UUID_MIXY_DIAG_COUNTERS_CHAR,
+};
+static int wanted_idx;
+
+static void discover_next(void);
+
+static uint8_t discovered(struct bt_conn *conn, const struct bt_gatt_attr *attr,
+                          struct bt_gatt_discover_params *params) {
+    if (attr) {
+        uint16_t handle = bt_gatt_attr_value_handle(attr);
+
+        if (wanted_idx == 0) {
+            midi_handle = handle;
+        } else {
+            diag_handle = handle;
+        }
+    } else if (wanted_idx == 0) {
+        printk("MIDI characteristic not found\n");
+        return BT_GATT_ITER_STOP;
+    }
+
+    wanted_idx++;
+    discover_next();
+    return BT_GATT_ITER_STOP;
+}
+
+static void discover_next(void) {
+    if (wanted_idx >= ARRAY_SIZE(wanted_chars)) {
+        midi_start();
+        return;
+    }
+
+    discover_params.uuid = wanted_chars[wanted_idx];
+    discover_params.func = discovered;
+    discover_params.start_handle = BT_ATT_FIRST_ATTRIBUTE_HANDLE;
+    discover_params.end_handle = BT_ATT_LAST_ATTRIBUTE_HANDLE;
+    discover_params.type = BT_GATT_DISCOVER_CHARACTERISTIC;
+
+    int err = bt_gatt_discover(mixy_conn, &discover_params);
+    if (err) {
+        printk("Discovery failed (err %d)\n", err);
+    }
+}
+
+static bool ad_has_midi(struct bt_data *data, void *user_data) {
+    static const uint8_t midi_uuid[] = {BT_UUID_REAL_MIDI_VAL};
+    bool *found = user_data;
+
+    if (data->type == BT_DATA_UUID128_ALL && data->data_len == sizeof(midi_uuid) &&
+        memcmp(data->data, midi_uuid, sizeof(midi_uuid)) == 0) {
+        *found = true;
+        return false;
+    }
+    return true;
+}
+
+static void device_found(const bt_addr_le_t *addr, int8_t rssi, uint8_t type,
+                         struct net_buf_simple *ad) {
+    bool found = false;
+
+    if (mixy_conn) return;
+
+    bt_data_parse(ad, ad_has_midi, &found);
+    if (!found) return;
+
+    if (bt_le_scan_stop()) return;
+
+    int err = bt_conn_le_create(addr, BT_CONN_LE_CREATE_CONN,
+                                BT_LE_CONN_PARAM(CONFIG_BENCH_CONN_INTERVAL,
+                                                 CONFIG_BENCH_CONN_INTERVAL, 0, 400),
+                                &mixy_conn);
+    if (err) {
+        printk("Connection create failed (err %d)\n", err);
+    }
+}
+
+static void connected(struct bt_conn *conn, uint8_t err) {
+    if (err) {
+        printk("Connection failed (err 0x%02x)\n", err);
+        bt_conn_unref(mixy_conn);
+        mixy_conn = NULL;
+        return;
+    }
+
+    wanted_idx = 0;
+    discover_next();
+}
+
+static void disconnected(struct bt_conn *conn, uint8_t reason) {
+    printk("Disconnected (reason 0x%02x)\n", reason);
+    k_work_cancel_delayable(&report_work);
+    bt_conn_unref(mixy_conn);
+    mixy_conn = NULL;
+}
+
+static bool le_param_req(struct bt_conn *conn, struct bt_le_conn_param *param) {
+    return !IS_ENABLED(CONFIG_BENCH_HOLD_CONN_INTERVAL);
+}
+
+BT_CONN_CB_DEFINE(conn_callbacks) = {
+    .connected = connected,
+    .disconnected = disconnected,
+    .le_param_req = le_param_req,
+};
+
+int main(void) {
+    int err = bt_enable(NULL);
+    if (err) {
+        printk("Bluetooth init failed (err %d)\n", err);
+        return 0;
+    }
+
+    err = bt_le_scan_start(BT_LE_SCAN_PASSIVE, device_found);
+    if (err) {
+        printk("Scanning failed to start (err %d)\n", err);
+    }
+
+    return 0;
+}
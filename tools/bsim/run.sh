@@ -0,0 +1,47 @@
+#!/usr/bin/env bash
+# BabbleSim BLE MIDI bench: Mixy (app/) with emulated pots against the
+# central in tools/bsim/central, for every connection interval and
+# pots_params preset below. Needs BSIM_OUT_PATH and BSIM_COMPONENTS_PATH
+# set up as described in Zephyr's nrf52_bsim board documentation.
+#
+# usage: tools/bsim/run.sh [build dir]
+
+set -e
+
+: "${BSIM_OUT_PATH:?BSIM_OUT_PATH must be set}"
+
+REPO=$(cd "$(dirname "$0")/../.." && pwd)
+BUILD=${1:-$REPO/build_bsim}
+
+# connection interval in 1.25 ms units
+INTERVALS="6 12 24"
+# minimum_change/slow_refresh_ms/fast_refresh_ms/fast_retention_ms
+PRESETS="10/400/70/300 4/400/15/1000"
+DURATION_S=30
+
+west build -p auto -b nrf52_bsim -d "$BUILD/mixy" "$REPO/app"
+
+for interval in $INTERVALS; do
+    for preset in $PRESETS; do
+        IFS=/ read -r min_change slow fast retention <<< "$preset"
+        central="$BUILD/central_${interval}_${min_change}_${slow}_${fast}_${retention}"
+
+        west build -p auto -b nrf52_bsim -d "$central" "$REPO/tools/bsim/central" -- \
+            -DCONFIG_BENCH_CONN_INTERVAL="$interval" \
+            -DCONFIG_BENCH_MIN_CHANGE="$min_change" \
+            -DCONFIG_BENCH_SLOW_REFRESH_MS="$slow" \
+            -DCONFIG_BENCH_FAST_REFRESH_MS="$fast" \
+            -DCONFIG_BENCH_FAST_RETENTION_MS="$retention" \
+            -DCONFIG_BENCH_DURATION_S="$DURATION_S"
+
+        sim_id="mixy_${interval}_${min_change}_${slow}_${fast}_${retention}"
+        # leave time for connecting and discovery before the measurement
+        sim_length_us=$(( (DURATION_S + 10) * 1000000 ))
+
+        "$BUILD/mixy/zephyr/zephyr.exe" -s="$sim_id" -d=0 > "$central.mixy.log" 2>&1 &
+        "$central/zephyr/zephyr.exe" -s="$sim_id" -d=1 2>&1 | grep "bsim bench" &
+        (cd "$BSIM_OUT_PATH/bin" && ./bs_2G4_phy_v1 -s="$sim_id" -D=2 -sim_length="$sim_length_us") > /dev/null
+
+        wait
+    done
+done
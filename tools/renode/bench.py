@@ -0,0 +1,123 @@
+#!/usr/bin/env python3
+"""
+Run nrf52840_bench.resc headless and summarize it: CPU active versus
+sleep time, SAADC conversions, ext_power (P0.13) toggles and radio
+events, with a rough charge estimate. The figures are approximate and
+meant for comparing two builds against each other, not for absolute
+power numbers.
+
+With CONFIG_POTS_TRIGGER_HW the SAADC samples and the per-frame rail
+pulses are triggered through PPI and never show up as register writes,
+compare the diagnostics service's ext_power counters instead.
+
+usage: tools/renode/bench.py [--elf build/zephyr/zephyr.elf] [--duration 60]
+"""
+
+import argparse
+import re
+import subprocess
+import sys
+from pathlib import Path
+
+REPO = Path(__file__).resolve().parents[2]
+
+EXT_POWER_PIN = 13
+
+# nRF52840 register offsets
+GPIO_OUT, GPIO_OUTSET, GPIO_OUTCLR = 0x504, 0x508, 0x50C
+SAADC_TASKS_START, SAADC_TASKS_SAMPLE = 0x000, 0x004
+RADIO_TASKS_TXEN, RADIO_TASKS_RXEN = 0x000, 0x004
+
+# rough nRF52840 currents at 3 V, DC/DC on
+CPU_ACTIVE_MA = 3.3
+SLEEP_MA = 0.003
+SAADC_SAMPLE_UC = 0.05   # ~1.2 mA for 40 us acquisition
+RADIO_EVENT_UC = 1.5     # ~5 mA for a ~300 us TX or RX window
+
+ACCESS_RE = re.compile(r"(\w+): .*Write\w* to 0x([0-9A-Fa-f]+).*value 0x([0-9A-Fa-f]+)")
+
+
+def parse_log(path):
+    counts = {"saadc_samples": 0, "saadc_starts": 0, "ext_power_toggles": 0, "radio_events": 0}
+    ext_power = None
+
+    for line in path.read_text(errors="replace").splitlines():
+        m = ACCESS_RE.search(line)
+        if not m:
+            continue
+        periph, offset, value = m.group(1), int(m.group(2), 16), int(m.group(3), 16)
+
+        if periph == "saadc":
+            if offset == SAADC_TASKS_SAMPLE and value:
+                counts["saadc_samples"] += 1
+            elif offset == SAADC_TASKS_START and value:
+                counts["saadc_starts"] += 1
+        elif periph == "radio":
+            if offset in (RADIO_TASKS_TXEN, RADIO_TASKS_RXEN) and value:
+                counts["radio_events"] += 1
+        elif periph == "gpio0":
+            pin_bit = bool(value & (1 << EXT_POWER_PIN))
+            # OUTSET/OUTCLR only act on the bits written as 1, OUT sets every pin
+            if offset == GPIO_OUTSET and pin_bit:
+                state = True
+            elif offset == GPIO_OUTCLR and pin_bit:
+                state = False
+            elif offset == GPIO_OUT:
+                state = pin_bit
+            else:
+                continue
+            if state != ext_power:
+                counts["ext_power_toggles"] += ext_power is not None
+                ext_power = state
+
+    return counts
+
+
+def monitor_value(output, marker):
+    lines = output.splitlines()
+    for i, line in enumerate(lines):
+        if marker in line:
+            for value in lines[i + 1:]:
+                m = re.search(r"([0-9][0-9.]*)", value)
+                if m:
+                    return float(m.group(1))
+    sys.exit(f"'{marker}' not found in Renode output")
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n\n")[0])
+    parser.add_argument("--elf", default="build/zephyr/zephyr.elf")
+    parser.add_argument("--duration", type=int, default=60, help="simulated seconds")
+    parser.add_argument("--log", default="build/renode_bench.log")
+    parser.add_argument("--renode", default="renode")
+    args = parser.parse_args()
+
+    log = Path(args.log).resolve()
+    elf = Path(args.elf).resolve()
+    commands = (f'$bin=@{elf}; $log=@{log}; $duration="{args.duration}"; '
+                f'include @{REPO / "nrf52840_bench.resc"}')
+
+    result = subprocess.run([args.renode, "--disable-xwt", "--console", "-e", commands],
+                            capture_output=True, text=True, check=True)
+
+    instructions = monitor_value(result.stdout, "bench: executed_instructions")
+    mips = monitor_value(result.stdout, "bench: performance_mips")
+    counts = parse_log(log)
+
+    active_s = instructions / (mips * 1e6)
+    sleep_s = max(args.duration - active_s, 0)
+    charge_uc = (active_s * CPU_ACTIVE_MA * 1000 + sleep_s * SLEEP_MA * 1000 +
+                 counts["saadc_samples"] * SAADC_SAMPLE_UC +
+                 counts["radio_events"] * RADIO_EVENT_UC)
+
+    print(f"simulated time     {args.duration} s")
+    print(f"CPU active         {active_s * 1000:.1f} ms ({100 * active_s / args.duration:.3f} %)")
+    print(f"CPU sleep          {sleep_s:.3f} s")
+    print(f"SAADC samples      {counts['saadc_samples']} ({counts['saadc_starts']} starts)")
+    print(f"ext_power toggles  {counts['ext_power_toggles']}")
+    print(f"radio events       {counts['radio_events']}")
+    print(f"average current    ~{charge_uc / args.duration:.1f} uA")
+
+
+if __name__ == "__main__":
+    main()